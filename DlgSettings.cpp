@@ -17,6 +17,8 @@ DlgSettings::DlgSettings(QWidget* parent) :
     ui.lePeople         ->setText(_settings.value("People")         .toString());
     ui.leIndexPattern   ->setText(_settings.value("IndexPattern")   .toString());
     ui.leExiftoolPath   ->setText(_settings.value("ExiftoolPath")   .toString());
+    ui.leTargetPath     ->setText(_settings.value("TargetPath")     .toString());
+    ui.leGazetteerPath  ->setText(_settings.value("GazetteerPath")  .toString());
 }
 
 void DlgSettings::accept()
@@ -27,6 +29,8 @@ void DlgSettings::accept()
     _settings.setValue("Event",             ui.leEvent          ->text());
     _settings.setValue("IndexPattern",      ui.leIndexPattern   ->text());
     _settings.setValue("ExiftoolPath",      ui.leExiftoolPath   ->text());
+    _settings.setValue("TargetPath",        ui.leTargetPath     ->text());
+    _settings.setValue("GazetteerPath",     ui.leGazetteerPath  ->text());
     _settings.setValue("Font",              ui.btFont->font().toString());
     qApp->setFont(ui.btFont->font());
     QDialog::accept();
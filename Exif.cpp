@@ -2,8 +2,41 @@
 
 #include <QFile>
 #include <QProcess>
+#include <QRegularExpression>
 #include <QSettings>
 
+namespace {
+///
+/// Parses a coordinate, e.g., 40 deg 26' 46.80" N, 40.446333 N, -40.446333
+/// negativeRef is the hemisphere (S or W) that makes it negative, also looked up in the ref property
+///
+bool parseCoordinate(const QString& value, const QString& ref, QChar negativeRef, double& result)
+{
+    const QRegularExpression dmsRegex(R"re(^\s*(-?[\d.]+)\s*deg\s*([\d.]+)'\s*([\d.]+)"?\s*([NSEW])?)re");
+    const QRegularExpression decimalRegex(R"(^\s*(-?[\d.]+)\s*([NSEW])?\s*$)");
+
+    QString hemisphere;
+    if (const auto match = dmsRegex.match(value); match.hasMatch())
+    {
+        result = match.captured(1).toDouble() + match.captured(2).toDouble() / 60 + match.captured(3).toDouble() / 3600;
+        hemisphere = match.captured(4);
+    }
+    else if (const auto match = decimalRegex.match(value); match.hasMatch())
+    {
+        result = match.captured(1).toDouble();
+        hemisphere = match.captured(2);
+    }
+    else
+        return false;
+
+    if (hemisphere.isEmpty())
+        hemisphere = ref.left(1).toUpper();
+    if (hemisphere == negativeRef && result > 0)
+        result = -result;
+    return true;
+}
+}
+
 Exif::Exif(const QString& filePath) : _filePath(filePath)
 {
     if (_filePath.isEmpty())
@@ -69,3 +102,13 @@ QString Exif::getFilePath() const
 {
     return _filePath;
 }
+
+void Exif::setFilePath(const QString& filePath) {
+    _filePath = filePath;
+}
+
+bool Exif::getGpsPosition(double& latitude, double& longitude) const
+{
+    return parseCoordinate(getValue("GPS Latitude"),  getValue("GPS Latitude Ref"),  'S', latitude) &&
+           parseCoordinate(getValue("GPS Longitude"), getValue("GPS Longitude Ref"), 'W', longitude);
+}
@@ -20,6 +20,15 @@ public:
 
     void setValue(const QString& property, const QString& value);
     QString getFilePath() const;
+    void setFilePath(const QString& filePath);
+
+    /**
+     * @brief Get the GPS position, in decimal degrees
+     * @param latitude  - receives the latitude, negative for south
+     * @param longitude - receives the longitude, negative for west
+     * @return          - whether the position is known
+     */
+    bool getGpsPosition(double& latitude, double& longitude) const;
 
 private:
     // Key value pairs
@@ -0,0 +1,310 @@
+#include "FileFilterModel.h"
+#include "FileIndex.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <numeric>
+
+FileFilterModel::FileFilterModel(FileIndex* index, QObject* parent)
+    : QAbstractProxyModel(parent),
+      _index(index)
+{
+}
+
+void FileFilterModel::setSourceModel(QAbstractItemModel* sourceModel)
+{
+    beginResetModel();
+    if (this->sourceModel() != nullptr)
+        disconnect(this->sourceModel(), nullptr, this, nullptr);
+
+    QAbstractProxyModel::setSourceModel(sourceModel);
+    if (sourceModel != nullptr)
+    {
+        connect(sourceModel, &QAbstractItemModel::dataChanged,          this, &FileFilterModel::onSourceDataChanged);
+        connect(sourceModel, &QAbstractItemModel::rowsInserted,         this, &FileFilterModel::onSourceRowsInserted);
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &FileFilterModel::onSourceRowsAboutToBeRemoved);
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved,          this, &FileFilterModel::onSourceRowsRemoved);
+
+        // Anything else rebuilds the mapping
+        connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset,    this, [this] { beginResetModel(); });
+        connect(sourceModel, &QAbstractItemModel::layoutAboutToBeChanged, this, [this] { beginResetModel(); });
+        connect(sourceModel, &QAbstractItemModel::modelReset,    this, &FileFilterModel::onSourceReset);
+        connect(sourceModel, &QAbstractItemModel::layoutChanged, this, &FileFilterModel::onSourceReset);
+    }
+    resetMapping();
+    endResetModel();
+}
+
+void FileFilterModel::refresh()
+{
+    beginLayoutChange();
+    updateOrder();
+    updateVisible();
+    endLayoutChange();
+}
+
+void FileFilterModel::sort(int column, Qt::SortOrder order)
+{
+    // Every key is re-read
+    _sortColumn = column;
+    _sortOrder  = order;
+    std::fill(_dirty.begin(), _dirty.end(), 1);
+    _order.clear();
+    refresh();
+}
+
+QModelIndex FileFilterModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= columnCount())
+        return {};
+    return createIndex(row, column);
+}
+
+QModelIndex FileFilterModel::parent(const QModelIndex& child) const
+{
+    Q_UNUSED(child)
+    return {};
+}
+
+int FileFilterModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : static_cast<int>(_sourceRows.size());
+}
+
+int FileFilterModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() || sourceModel() == nullptr ? 0 : sourceModel()->columnCount();
+}
+
+bool FileFilterModel::hasChildren(const QModelIndex& parent) const {
+    return rowCount(parent) > 0 && columnCount(parent) > 0;
+}
+
+QVariant FileFilterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (sourceModel() == nullptr)
+        return {};
+
+    // Row headers follow their rows
+    if (orientation == Qt::Vertical && section >= 0 && section < rowCount())
+        return sourceModel()->headerData(_sourceRows[section], orientation, role);
+    return sourceModel()->headerData(section, orientation, role);
+}
+
+QModelIndex FileFilterModel::mapToSource(const QModelIndex& proxyIndex) const
+{
+    if (!proxyIndex.isValid() || proxyIndex.row() >= rowCount())
+        return {};
+    return sourceModel()->index(_sourceRows[proxyIndex.row()], proxyIndex.column());
+}
+
+QModelIndex FileFilterModel::mapFromSource(const QModelIndex& sourceIndex) const
+{
+    if (!sourceIndex.isValid() || sourceIndex.row() >= static_cast<int>(_proxyRows.size()))
+        return {};
+
+    const int proxyRow = _proxyRows[sourceIndex.row()];
+    return proxyRow < 0 ? QModelIndex() : createIndex(proxyRow, sourceIndex.column());
+}
+
+void FileFilterModel::onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight,
+                                          const QVector<int>& roles)
+{
+    if (!topLeft.isValid() || topLeft.parent().isValid())
+        return;
+
+    // Changed keys are re-sorted on the next refresh, not one by one
+    const bool keyChanged = _sortColumn >= topLeft.column() && _sortColumn <= bottomRight.column();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+    {
+        if (keyChanged)
+            _dirty[row] = 1;
+
+        const int proxyRow = _proxyRows[row];
+        if (proxyRow >= 0)
+            emit dataChanged(index(proxyRow, topLeft.column()), index(proxyRow, bottomRight.column()), roles);
+    }
+}
+
+void FileFilterModel::onSourceRowsInserted(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+
+    // The proxy rows stay the same, only the source rows after the new ones shift
+    const int count = last - first + 1;
+    _ids      .insert(_ids      .begin() + first, count, -1);
+    _keys     .insert(_keys     .begin() + first, count, QString());
+    _dirty    .insert(_dirty    .begin() + first, count, 1);
+    _proxyRows.insert(_proxyRows.begin() + first, count, -1);
+    for (int& row: _order)
+        if (row >= first)
+            row += count;
+    for (int& row: _sourceRows)
+        if (row >= first)
+            row += count;
+}
+
+void FileFilterModel::onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+
+    // Remove the visible ones from the proxy, one contiguous run of proxy rows at a time, bottom up
+    std::vector<int> proxyRows;
+    for (int row = first; row <= last; ++row)
+        if (_proxyRows[row] >= 0)
+            proxyRows.push_back(_proxyRows[row]);
+    if (proxyRows.empty())
+        return;
+
+    std::sort(proxyRows.begin(), proxyRows.end(), std::greater<int>());
+    for (std::size_t i = 0; i < proxyRows.size(); )
+    {
+        const int lastProxyRow = proxyRows[i++];
+        int firstProxyRow = lastProxyRow;
+        while (i < proxyRows.size() && proxyRows[i] == firstProxyRow - 1)
+            firstProxyRow = proxyRows[i++];
+
+        beginRemoveRows(QModelIndex(), firstProxyRow, lastProxyRow);
+        _sourceRows.erase(_sourceRows.begin() + firstProxyRow, _sourceRows.begin() + lastProxyRow + 1);
+        endRemoveRows();
+    }
+
+    // Renumber the proxy rows after the first removed one
+    for (int row = first; row <= last; ++row)
+        _proxyRows[row] = -1;
+    for (int proxyRow = proxyRows.back(); proxyRow < rowCount(); ++proxyRow)
+        _proxyRows[_sourceRows[proxyRow]] = proxyRow;
+}
+
+void FileFilterModel::onSourceRowsRemoved(const QModelIndex& parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+
+    // The proxy already dropped the rows, only the source rows after them shift. Still in order
+    const int count = last - first + 1;
+    _ids      .erase(_ids      .begin() + first, _ids      .begin() + last + 1);
+    _keys     .erase(_keys     .begin() + first, _keys     .begin() + last + 1);
+    _dirty    .erase(_dirty    .begin() + first, _dirty    .begin() + last + 1);
+    _proxyRows.erase(_proxyRows.begin() + first, _proxyRows.begin() + last + 1);
+
+    _order.erase(std::remove_if(_order.begin(), _order.end(), [first, last](int row) {
+        return row >= first && row <= last;
+    }), _order.end());
+    for (int& row: _order)
+        if (row > last)
+            row -= count;
+    for (int& row: _sourceRows)
+        if (row > last)
+            row -= count;
+}
+
+void FileFilterModel::onSourceReset()
+{
+    resetMapping();
+    endResetModel();
+}
+
+void FileFilterModel::beginLayoutChange()
+{
+    emit layoutAboutToBeChanged();
+
+    // Source indexes follow the source rows through insertions and removals
+    _layoutProxyIndexes = persistentIndexList();
+    _layoutSourceIndexes.clear();
+    for (const QModelIndex& proxyIndex: qAsConst(_layoutProxyIndexes))
+        _layoutSourceIndexes << QPersistentModelIndex(mapToSource(proxyIndex));
+}
+
+void FileFilterModel::endLayoutChange()
+{
+    QModelIndexList proxyIndexes;
+    for (const QPersistentModelIndex& sourceIndex: qAsConst(_layoutSourceIndexes))
+        proxyIndexes << mapFromSource(sourceIndex);
+    changePersistentIndexList(_layoutProxyIndexes, proxyIndexes);
+
+    _layoutProxyIndexes .clear();
+    _layoutSourceIndexes.clear();
+    emit layoutChanged();
+}
+
+void FileFilterModel::resetMapping()
+{
+    const int count = sourceModel() == nullptr ? 0 : sourceModel()->rowCount();
+    _ids      .assign(count, -1);
+    _keys     .assign(count, QString());
+    _dirty    .assign(count, 1);
+    _proxyRows.assign(count, -1);
+    _order     .clear();
+    _sourceRows.clear();
+    updateOrder();
+    updateVisible();
+}
+
+void FileFilterModel::updateOrder()
+{
+    const int count = static_cast<int>(_dirty.size());
+    if (_sortColumn < 0)
+    {
+        _order.resize(count);
+        std::iota(_order.begin(), _order.end(), 0);
+        std::fill(_dirty.begin(), _dirty.end(), 0);
+        return;
+    }
+
+    // Sort the changed rows only, then merge them into the others, which are still in order
+    std::vector<int> unchanged;
+    unchanged.reserve(_order.size());
+    for (int row: _order)
+        if (!_dirty[row])
+            unchanged.push_back(row);
+
+    std::vector<int> changed;
+    for (int row = 0; row < count; ++row)
+        if (_dirty[row])
+        {
+            _keys[row]  = sourceModel()->index(row, _sortColumn).data().toString();
+            _dirty[row] = 0;
+            changed.push_back(row);
+        }
+    if (changed.empty())
+        return;
+
+    const auto less = [this](int lhs, int rhs) { return lessThan(lhs, rhs); };
+    std::sort(changed.begin(), changed.end(), less);
+    _order.clear();
+    _order.reserve(count);
+    std::merge(unchanged.begin(), unchanged.end(), changed.begin(), changed.end(), std::back_inserter(_order), less);
+}
+
+void FileFilterModel::updateVisible()
+{
+    // One pass over the accepted ids, no lookups into the source except for ids not read yet
+    _sourceRows.clear();
+    std::fill(_proxyRows.begin(), _proxyRows.end(), -1);
+    for (int row: _order)
+    {
+        if (_ids[row] < 0)
+        {
+            const QVariant id = sourceModel()->index(row, 0).data(RowIdRole);
+            if (id.isValid())
+                _ids[row] = id.toInt();
+        }
+
+        if (_index->isAccepted(_ids[row]))
+        {
+            _proxyRows[row] = static_cast<int>(_sourceRows.size());
+            _sourceRows.push_back(row);
+        }
+    }
+}
+
+bool FileFilterModel::lessThan(int lhsRow, int rhsRow) const
+{
+    // Ties keep the source order, same as a stable sort
+    const int result = QString::compare(_keys[lhsRow], _keys[rhsRow]);
+    if (result != 0)
+        return _sortOrder == Qt::AscendingOrder ? result < 0 : result > 0;
+    return lhsRow < rhsRow;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QAbstractProxyModel>
+#include <QPersistentModelIndex>
+#include <QVector>
+#include <vector>
+
+class FileIndex;
+
+///
+/// @brief Filters and sorts the file table by looking up the precomputed FileIndex
+///
+/// The source is a flat table. Changes of the query, the index, or the sorted column are
+/// applied in one pass by refresh(), so that bulk updates don't re-filter or re-sort per row.
+/// Rows inserted into the source are hidden until the next refresh(), removed rows leave right away.
+///
+class FileFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    // Role in the first column holding the id of the file in the index
+    enum {RowIdRole = Qt::UserRole + 1};
+
+    FileFilterModel(FileIndex* index, QObject* parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel* sourceModel) override;
+
+    /**
+     * @brief Re-filter after the query or the index changed, and re-sort the rows changed since the last refresh
+     */
+    void refresh();
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount   (const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    QModelIndex mapToSource  (const QModelIndex& proxyIndex)  const override;
+    QModelIndex mapFromSource(const QModelIndex& sourceIndex) const override;
+
+private slots:
+    void onSourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QVector<int>& roles);
+    void onSourceRowsInserted(const QModelIndex& parent, int first, int last);
+    void onSourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceRowsRemoved(const QModelIndex& parent, int first, int last);
+    void onSourceReset();
+
+private:
+    // Proxy rows change between the two, persistent indexes are carried over through the source
+    void beginLayoutChange();
+    void endLayoutChange();
+
+    void resetMapping();
+    void updateOrder();
+    void updateVisible();
+    bool lessThan(int lhsRow, int rhsRow) const;
+
+private:
+    FileIndex* _index;
+
+    // Per source row
+    std::vector<int>     _ids;       // -1 if not read yet
+    std::vector<QString> _keys;      // value in the sorted column
+    std::vector<char>    _dirty;     // key changed since the last refresh
+    std::vector<int>     _proxyRows; // -1 if hidden
+
+    std::vector<int> _order;         // all source rows, sorted
+    std::vector<int> _sourceRows;    // per proxy row
+
+    int             _sortColumn{-1};
+    Qt::SortOrder   _sortOrder{Qt::AscendingOrder};
+
+    QModelIndexList              _layoutProxyIndexes;
+    QList<QPersistentModelIndex> _layoutSourceIndexes;
+};
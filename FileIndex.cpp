@@ -0,0 +1,357 @@
+#include "FileIndex.h"
+
+#include <QFileInfo>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+constexpr int MaxNgramLength = 3;
+}
+
+void FileIndex::SortedDates::add(int id, qint64 time) {
+    pending.push_back({time, id});
+}
+
+void FileIndex::SortedDates::merge()
+{
+    if (pending.empty())
+        return;
+
+    std::sort(pending.begin(), pending.end());
+    const auto middle = static_cast<std::ptrdiff_t>(sorted.size());
+    sorted.insert(sorted.end(), pending.begin(), pending.end());
+    std::inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end());
+    pending.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+void FileIndex::addFile(int id, const QString& filePath, const QDateTime& modifiedDateTime)
+{
+    resize(id);
+
+    const QString path = filePath.toLower();
+    const QString extension = QFileInfo(path).suffix();
+    const qint64 modifiedTime = modifiedDateTime.toSecsSinceEpoch();
+    _paths[id]          = path;
+    _extensions[id]     = extension;
+    _modifiedTimes[id]  = modifiedTime;
+    _alive.setBit(id);
+
+    // ids only grow, so the lists stay sorted
+    for (int n = 1; n <= MaxNgramLength; ++n)
+        for (quint64 ngram: ngrams(path, n))
+            _ngrams[ngram].push_back(id);
+    _extensionIds[extension].push_back(id);
+    _modifiedDates.add(id, modifiedTime);
+
+    update(id);
+}
+
+void FileIndex::setExifDate(int id, const QDateTime& exifDateTime)
+{
+    if (id >= _paths.count() || !exifDateTime.isValid())
+        return;
+
+    _exifTimes[id] = exifDateTime.toSecsSinceEpoch();
+    _exifDates.add(id, _exifTimes[id]);
+    _mismatch.setBit(id, _exifTimes[id] != _modifiedTimes[id]);
+    update(id);
+}
+
+void FileIndex::setGuessedDate(int id, const QDateTime& guessedDateTime)
+{
+    if (id >= _paths.count() || !guessedDateTime.isValid())
+        return;
+
+    _guessedTimes[id] = guessedDateTime.toSecsSinceEpoch();
+    _guessedDates.add(id, _guessedTimes[id]);
+    update(id);
+}
+
+void FileIndex::setDateSource(int id, DateSource source)
+{
+    if (id >= _paths.count())
+        return;
+
+    _modifiedSource.setBit(id, source == ModifiedDate);
+    _exifSource    .setBit(id, source == ExifDate);
+    _guessedSource .setBit(id, source == GuessedDate);
+    update(id);
+}
+
+void FileIndex::removeFile(int id)
+{
+    if (id >= _paths.count())
+        return;
+
+    // Leave the postings, dead ids are masked out by _alive
+    _alive   .clearBit(id);
+    _accepted.clearBit(id);
+}
+
+void FileIndex::clear()
+{
+    const QList<Term> terms = _terms;
+    *this = FileIndex();
+    _terms = terms;
+}
+
+bool FileIndex::setQuery(const QString& query)
+{
+    const QList<Term> terms = parse(query);
+    if (terms == _terms)
+        return false;
+
+    // A narrower query only needs to look at what the previous one accepted
+    QBitArray accepted = !_terms.isEmpty() && narrows(terms, _terms) ? _accepted : _alive;
+    _terms = terms;
+
+    bool hasLongSubstring = false;
+    for (const auto& term: _terms)
+    {
+        accepted &= evaluate(term);
+        hasLongSubstring = hasLongSubstring || (term.kind == Term::Substring && term.text.length() > MaxNgramLength);
+    }
+
+    // Trigrams only give candidates for longer terms, verify them
+    if (hasLongSubstring)
+        for (int id = 0; id < accepted.size(); ++id)
+            if (accepted.testBit(id))
+                for (const auto& term: _terms)
+                    if (term.kind == Term::Substring && term.text.length() > MaxNgramLength && !matches(id, term))
+                    {
+                        accepted.clearBit(id);
+                        break;
+                    }
+
+    _accepted = accepted;
+    return true;
+}
+
+bool FileIndex::isAccepted(int id) const
+{
+    if (_terms.isEmpty())
+        return true;
+    return id >= 0 && id < _accepted.size() && _accepted.testBit(id);
+}
+
+QList<FileIndex::Term> FileIndex::parse(const QString& query)
+{
+    QList<Term> terms;
+    for (const QString& word: query.toLower().split(' ', Qt::SkipEmptyParts))
+    {
+        Term term{Term::Substring, word};
+        if (word.startsWith("ext:"))
+        {
+            QString extension = word.mid(4);
+            if (extension.startsWith('.'))
+                extension.remove(0, 1);
+            term = {Term::Extension, extension};
+        }
+        else if (word.startsWith("date:"))
+            term = {Term::Source, word.mid(5)};
+        else if (word == "mismatch")
+            term = {Term::Mismatch, {}};
+        else if (word.startsWith("after:") || word.startsWith("before:"))
+        {
+            // Skip incomplete dates while the user is typing
+            const bool after = word.startsWith("after:");
+            const QDate date = QDate::fromString(word.mid(after ? 6 : 7), "yyyy-MM-dd");
+            if (!date.isValid())
+                continue;
+            term = after ? Term{Term::After,  {}, date.startOfDay().toSecsSinceEpoch()}
+                         : Term{Term::Before, {}, date.endOfDay()  .toSecsSinceEpoch()};
+        }
+
+        if (term.text.isEmpty() && (term.kind == Term::Extension || term.kind == Term::Source))
+            continue;
+        terms << term;
+    }
+    return terms;
+}
+
+bool FileIndex::narrows(const QList<Term>& newTerms, const QList<Term>& oldTerms)
+{
+    // Every old term must be implied by some new term
+    for (const auto& oldTerm: oldTerms)
+    {
+        const bool implied = std::any_of(newTerms.begin(), newTerms.end(), [&oldTerm](const Term& newTerm) {
+            if (newTerm.kind != oldTerm.kind)
+                return false;
+            switch (newTerm.kind)
+            {
+            case Term::Substring: return newTerm.text.contains(oldTerm.text);
+            case Term::After:     return newTerm.time >= oldTerm.time;
+            case Term::Before:    return newTerm.time <= oldTerm.time;
+            default:              return newTerm == oldTerm;
+            }
+        });
+        if (!implied)
+            return false;
+    }
+    return true;
+}
+
+std::vector<quint64> FileIndex::ngrams(const QString& text, int n)
+{
+    std::vector<quint64> result;
+    for (int i = 0; i + n <= text.length(); ++i)
+    {
+        quint64 ngram = quint64(n);
+        for (int j = 0; j < n; ++j)
+            ngram = ngram << 16 | text.at(i + j).unicode();
+        result.push_back(ngram);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void FileIndex::resize(int id)
+{
+    while (_paths.count() <= id)
+    {
+        _paths          << QString();
+        _extensions     << QString();
+        _modifiedTimes  << -1;
+        _exifTimes      << -1;
+        _guessedTimes   << -1;
+    }
+
+    const int size = _paths.count();
+    if (_alive.size() < size)
+    {
+        _alive          .resize(size);
+        _modifiedSource .resize(size);
+        _exifSource     .resize(size);
+        _guessedSource  .resize(size);
+        _mismatch       .resize(size);
+        _accepted       .resize(size);
+    }
+}
+
+void FileIndex::update(int id) {
+    _accepted.setBit(id, _alive.testBit(id) && matches(id));
+}
+
+bool FileIndex::matches(int id) const
+{
+    for (const auto& term: _terms)
+        if (!matches(id, term))
+            return false;
+    return true;
+}
+
+bool FileIndex::matches(int id, const Term& term) const
+{
+    switch (term.kind)
+    {
+    case Term::Substring:   return _paths.at(id).contains(term.text);
+    case Term::Extension:   return _extensions.at(id) == term.text;
+    case Term::Mismatch:    return _mismatch.testBit(id);
+    case Term::After:       return dateInUse(id) >= 0 && dateInUse(id) >= term.time;
+    case Term::Before:      return dateInUse(id) >= 0 && dateInUse(id) <= term.time;
+    case Term::Source:
+        if (term.text == "exif")
+            return _exifSource.testBit(id);
+        if (term.text == "modified")
+            return _modifiedSource.testBit(id);
+        if (term.text == "guessed")
+            return _guessedSource.testBit(id);
+        if (term.text == "none")
+            return !_exifSource.testBit(id) && !_modifiedSource.testBit(id) && !_guessedSource.testBit(id);
+        return false;
+    }
+    return false;
+}
+
+QBitArray FileIndex::evaluate(const Term& term)
+{
+    const int size = _alive.size();
+    switch (term.kind)
+    {
+    case Term::Substring:
+    {
+        // Candidates are the files containing every n-gram of the text, exact for short texts
+        std::vector<const std::vector<int>*> postings;
+        for (quint64 ngram: ngrams(term.text, std::min(term.text.length(), MaxNgramLength)))
+        {
+            const auto it = _ngrams.constFind(ngram);
+            if (it == _ngrams.constEnd())
+                return QBitArray(size);
+            postings.push_back(&it.value());
+        }
+
+        // Intersect from the shortest list
+        std::sort(postings.begin(), postings.end(), [](const auto* lhs, const auto* rhs) {
+            return lhs->size() < rhs->size();
+        });
+        std::vector<int> ids = *postings.front();
+        for (std::size_t i = 1; i < postings.size() && !ids.empty(); ++i)
+        {
+            std::vector<int> intersection;
+            std::set_intersection(ids.begin(), ids.end(), postings[i]->begin(), postings[i]->end(),
+                                  std::back_inserter(intersection));
+            ids.swap(intersection);
+        }
+
+        QBitArray result(size);
+        for (int id: ids)
+            result.setBit(id);
+        return result;
+    }
+    case Term::Extension:
+    {
+        QBitArray result(size);
+        for (int id: _extensionIds.value(term.text))
+            result.setBit(id);
+        return result;
+    }
+    case Term::Source:
+        if (term.text == "exif")
+            return _exifSource;
+        if (term.text == "modified")
+            return _modifiedSource;
+        if (term.text == "guessed")
+            return _guessedSource;
+        if (term.text == "none")
+            return ~(_exifSource | _modifiedSource | _guessedSource);
+        return QBitArray(size);
+    case Term::Mismatch:
+        return _mismatch;
+    case Term::After:
+        return (inRange(_modifiedDates, term.time, std::numeric_limits<qint64>::max()) & _modifiedSource) |
+               (inRange(_exifDates,     term.time, std::numeric_limits<qint64>::max()) & _exifSource)     |
+               (inRange(_guessedDates,  term.time, std::numeric_limits<qint64>::max()) & _guessedSource);
+    case Term::Before:
+        return (inRange(_modifiedDates, 0, term.time) & _modifiedSource) |
+               (inRange(_exifDates,     0, term.time) & _exifSource)     |
+               (inRange(_guessedDates,  0, term.time) & _guessedSource);
+    }
+    return QBitArray(size);
+}
+
+QBitArray FileIndex::inRange(SortedDates& dates, qint64 from, qint64 to)
+{
+    dates.merge();
+
+    QBitArray result(_alive.size());
+    auto it = std::lower_bound(dates.sorted.begin(), dates.sorted.end(), SortedDates::Entry{from, 0});
+    for (; it != dates.sorted.end() && it->time <= to; ++it)
+        result.setBit(it->id);
+    return result;
+}
+
+qint64 FileIndex::dateInUse(int id) const
+{
+    if (_exifSource.testBit(id))
+        return _exifTimes.at(id);
+    if (_modifiedSource.testBit(id))
+        return _modifiedTimes.at(id);
+    if (_guessedSource.testBit(id))
+        return _guessedTimes.at(id);
+    return -1;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QBitArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+///
+/// @brief Precomputed indexes over the files in the table, for fast filtering
+///
+/// Files are identified by ids that are never reused until clear().
+/// The query is a list of space-separated terms, all of which must match:
+///     ext:jpg                 extension
+///     date:exif|modified|guessed|none
+///                             source of the date in use
+///     mismatch                EXIF and modified dates disagree
+///     after:yyyy-MM-dd        date in use on or after
+///     before:yyyy-MM-dd       date in use on or before
+///     anything else           case-insensitive path substring
+///
+class FileIndex
+{
+public:
+    enum DateSource {NoDate, ModifiedDate, ExifDate, GuessedDate};
+
+    void addFile(int id, const QString& filePath, const QDateTime& modifiedDateTime);
+    void setExifDate(int id, const QDateTime& exifDateTime);
+    void setGuessedDate(int id, const QDateTime& guessedDateTime);
+    void setDateSource(int id, DateSource source);
+    void removeFile(int id);
+    void clear();
+
+    /**
+     * @brief Set the filter query and recompute the accepted files
+     * @return  - true if the query changed
+     */
+    bool setQuery(const QString& query);
+
+    /**
+     * @brief Whether a file is accepted by the current query
+     * @param id    - the file, -1 for a file not indexed yet
+     */
+    bool isAccepted(int id) const;
+
+private:
+    struct Term
+    {
+        enum Kind {Substring, Extension, Source, Mismatch, After, Before};
+        Kind    kind;
+        QString text;       // Substring, Extension, Source
+        qint64  time{0};    // After, Before, in secs since epoch
+
+        bool operator==(const Term& other) const {
+            return kind == other.kind && text == other.text && time == other.time;
+        }
+    };
+
+    ///
+    /// @brief Dates sorted for range queries; new dates are merged in lazily
+    ///
+    struct SortedDates
+    {
+        struct Entry
+        {
+            qint64 time;
+            int    id;
+            bool operator<(const Entry& other) const { return time < other.time; }
+        };
+        std::vector<Entry> sorted;
+        std::vector<Entry> pending;
+
+        void add(int id, qint64 time);
+        void merge();
+    };
+
+    static QList<Term> parse(const QString& query);
+    static bool narrows(const QList<Term>& newTerms, const QList<Term>& oldTerms);
+    // Substrings of n (1 to 3) characters, with n in the key
+    static std::vector<quint64> ngrams(const QString& text, int n);
+
+    void resize(int id);
+    void update(int id);        // re-evaluates the current query for one file
+    bool matches(int id) const;
+    bool matches(int id, const Term& term) const;
+    QBitArray evaluate(const Term& term);
+    QBitArray inRange(SortedDates& dates, qint64 from, qint64 to);
+    qint64 dateInUse(int id) const;
+
+private:
+    // Per file, indexed by id
+    QStringList     _paths;             // lower case
+    QStringList     _extensions;        // lower case
+    QList<qint64>   _modifiedTimes;
+    QList<qint64>   _exifTimes;         // -1 if unknown
+    QList<qint64>   _guessedTimes;      // -1 if unknown
+    QBitArray       _alive;
+    QBitArray       _modifiedSource;    // date in use is the modified date
+    QBitArray       _exifSource;        // date in use is the EXIF date
+    QBitArray       _guessedSource;     // date in use is guessed, e.g., from the file name
+    QBitArray       _mismatch;          // EXIF and modified dates disagree
+
+    // n-gram -> ids (ascending) of the paths containing it.
+    // Terms of up to 3 characters are answered by their own n-gram, longer ones by the trigrams
+    QHash<quint64, std::vector<int>> _ngrams;
+
+    // extension -> ids (ascending)
+    QHash<QString, std::vector<int>> _extensionIds;
+
+    SortedDates _modifiedDates;
+    SortedDates _exifDates;
+    SortedDates _guessedDates;
+
+    QList<Term> _terms;
+    QBitArray   _accepted;
+};
@@ -0,0 +1,226 @@
+#include "FileMover.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QStorageInfo>
+#include <memory>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace {
+constexpr qint64 StreamBufferSize = 4 * 1024 * 1024;
+constexpr auto ChecksumAlgorithm = QCryptographicHash::Sha1;
+}
+
+QList<QList<FileMover::Job>> FileMover::makeBatches(const QList<Job>& jobs, int batchSize)
+{
+    QList<QList<Job>> batches;
+    for (int i = 0; i < jobs.count(); i += batchSize)
+        batches << jobs.mid(i, batchSize);
+    return batches;
+}
+
+QList<FileMover::Result> FileMover::moveBatch(const QList<Job>& jobs)
+{
+    QList<Result> results;
+
+    // Copies waiting to be flushed and verified
+    std::vector<std::unique_ptr<QFile>> copies;
+    QList<QByteArray> sourceHashes;
+    QList<int> copyIndices;   // index into results of each copy
+
+    for (const auto& job: jobs)
+    {
+        Result result{job.from, job.to, {}};
+        const QString destDir = QFileInfo(job.to).path();
+
+        if (!QDir().mkpath(destDir))
+            result.error = QString("Unable to create %1").arg(destDir);
+        else if (isSameDevice(job.from, destDir))
+        {
+            QFile file(job.from);
+            if (!file.rename(job.to))
+                result.error = file.errorString();
+        }
+        else
+        {
+            auto dest = std::make_unique<QFile>(job.to);
+            QByteArray sourceHash;
+            if (!dest->open(QIODevice::WriteOnly | QIODevice::NewOnly | QIODevice::Unbuffered))
+                result.error = dest->errorString();
+            else if (result.error = copy(job.from, *dest, sourceHash); !result.error.isEmpty())
+                dest->remove();
+            else
+            {
+                // Keep the modified date, the renaming may be based on it
+                dest->setFileTime(QFileInfo(job.from).lastModified(), QFileDevice::FileModificationTime);
+                copyIndices << results.count();
+                sourceHashes << sourceHash;
+                copies.push_back(std::move(dest));
+            }
+        }
+        results << result;
+    }
+
+    // Flush and verify the whole batch
+    QSet<QString> destDirs;
+    for (int i = 0; i < copyIndices.count(); ++i)
+    {
+        QFile& dest = *copies[i];
+        Result& result = results[copyIndices.at(i)];
+
+        bool synced = dest.flush();
+#ifdef Q_OS_UNIX
+        synced = synced && ::fsync(dest.handle()) == 0;
+#endif
+#ifdef Q_OS_LINUX
+        // Drop cached pages so that the verification reads back from the device
+        ::posix_fadvise(dest.handle(), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+        dest.close();
+
+        if (!synced)
+            result.error = QString("Unable to flush %1").arg(result.to);
+        else if (checksum(result.to) != sourceHashes.at(i))
+            result.error = QString("Checksum mismatch on %1").arg(result.to);
+
+        if (result.error.isEmpty())
+            destDirs << QFileInfo(result.to).path();
+        else
+            QFile::remove(result.to);
+    }
+
+    // Persist the new directory entries once per directory, before any source is unlinked,
+    // otherwise a crash may keep the unlink but lose the entry
+    QSet<QString> unsyncedDirs;
+    for (const auto& dir: qAsConst(destDirs))
+        if (!syncDirectory(dir))
+            unsyncedDirs << dir;
+
+    for (int index: qAsConst(copyIndices))
+    {
+        Result& result = results[index];
+        if (!result.error.isEmpty())
+            continue;
+
+        const QString destDir = QFileInfo(result.to).path();
+        if (unsyncedDirs.contains(destDir))
+        {
+            result.error = QString("Unable to flush %1").arg(destDir);
+            QFile::remove(result.to);
+            continue;
+        }
+
+        // The copy is verified, keep it even if the source can't be removed
+        if (!QFile::remove(result.from))
+            result.error = QString("Copied, but unable to remove %1").arg(result.from);
+    }
+    return results;
+}
+
+bool FileMover::syncDirectory(const QString& dirPath)
+{
+#ifdef Q_OS_UNIX
+    const int fd = ::open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+#else
+    Q_UNUSED(dirPath)
+    return true;    // the directory entry is flushed with the file
+#endif
+}
+
+bool FileMover::isSameDevice(const QString& filePath, const QString& dirPath)
+{
+#ifdef Q_OS_UNIX
+    struct stat fileStat, dirStat;
+    return ::stat(QFile::encodeName(filePath).constData(), &fileStat) == 0 &&
+           ::stat(QFile::encodeName(dirPath) .constData(), &dirStat)  == 0 &&
+           fileStat.st_dev == dirStat.st_dev;
+#else
+    return QStorageInfo(filePath) == QStorageInfo(dirPath);
+#endif
+}
+
+QString FileMover::copy(const QString& from, QFile& to, QByteArray& sourceHash)
+{
+    QFile source(from);
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return source.errorString();
+
+#ifdef Q_OS_LINUX
+    // Let the file system (reflink) or the kernel (copy_file_range) do the copy,
+    // so that the data never goes through user space
+    const int sourceFd = source.handle();
+    const int destFd   = to.handle();
+    const qint64 size  = source.size();
+    bool copied = ::ioctl(destFd, FICLONE, sourceFd) == 0;
+    if (!copied)
+    {
+        qint64 remaining = size;
+        while (remaining > 0)
+        {
+            const ssize_t n = ::copy_file_range(sourceFd, nullptr, destFd, nullptr,
+                                                static_cast<size_t>(remaining), 0);
+            if (n <= 0)
+                break;
+            remaining -= n;
+        }
+
+        if (remaining == 0)
+            copied = true;
+        else if (remaining != size)     // failed halfway, nothing to fall back to
+            return QString("Unable to copy %1: %2").arg(from, QString::fromLocal8Bit(std::strerror(errno)));
+    }
+
+    if (copied)
+    {
+        sourceHash = checksum(from);
+        return sourceHash.isEmpty() ? QString("Unable to read %1").arg(from) : QString();
+    }
+#endif
+
+    // Stream with a large buffer, hashing along the way
+    QCryptographicHash hash(ChecksumAlgorithm);
+    QByteArray buffer(StreamBufferSize, Qt::Uninitialized);
+    qint64 n = 0;
+    while ((n = source.read(buffer.data(), buffer.size())) > 0)
+    {
+        hash.addData(buffer.constData(), static_cast<int>(n));
+        if (to.write(buffer.constData(), n) != n)
+            return to.errorString();
+    }
+    if (n < 0)
+        return source.errorString();
+
+    sourceHash = hash.result();
+    return {};
+}
+
+QByteArray FileMover::checksum(const QString& filePath)
+{
+    QFile file(filePath);
+    QCryptographicHash hash(ChecksumAlgorithm);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file))
+        return {};
+    return hash.result();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QFile;
+
+///
+/// @brief Moves files, possibly across file systems
+///
+/// Files on the same device are simply renamed. Otherwise the data is copied
+/// (reflink / copy_file_range where available, large-buffer streaming otherwise),
+/// flushed to disk, verified by checksum, and only then is the source removed.
+/// The destination directories are flushed once per batch, before any source is removed.
+///
+class FileMover
+{
+public:
+    struct Job
+    {
+        QString from;
+        QString to;
+    };
+
+    struct Result
+    {
+        QString from;
+        QString to;
+        QString error;  // empty on success
+    };
+
+    /**
+     * @brief Split jobs into batches that are moved and fsync'ed together
+     * @param jobs      - all files to be moved
+     * @param batchSize - max # of files in a batch
+     * @return          - the batches
+     */
+    static QList<QList<Job>> makeBatches(const QList<Job>& jobs, int batchSize = 16);
+
+    /**
+     * @brief Move a batch of files. Thread-safe, meant to be run concurrently on different batches
+     * @param jobs  - the files to be moved
+     * @return      - one result per job
+     */
+    static QList<Result> moveBatch(const QList<Job>& jobs);
+
+private:
+    static bool isSameDevice(const QString& filePath, const QString& dirPath);
+    static bool syncDirectory(const QString& dirPath);
+
+    /**
+     * @brief Copy the content of a file into an opened, empty file
+     * @param from          - source file path
+     * @param to            - the destination file
+     * @param sourceHash    - returns the checksum of the source
+     * @return              - error message, empty on success
+     */
+    static QString copy(const QString& from, QFile& to, QByteArray& sourceHash);
+
+    static QByteArray checksum(const QString& filePath);
+};
@@ -0,0 +1,223 @@
+#include "Gazetteer.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+constexpr char      IndexMagic[8] = {'R', 'N', 'M', 'G', 'A', 'Z', 0, 0};
+constexpr quint32   IndexVersion  = 1;
+constexpr double    Pi            = 3.14159265358979323846;
+
+// Positions are points on the unit sphere, so that the euclidean distance
+// orders places the same as the great-circle distance, across the antimeridian too
+void toUnitVector(double latitude, double longitude, float position[3])
+{
+    const double lat = latitude  * Pi / 180;
+    const double lon = longitude * Pi / 180;
+    position[0] = static_cast<float>(std::cos(lat) * std::cos(lon));
+    position[1] = static_cast<float>(std::cos(lat) * std::sin(lon));
+    position[2] = static_cast<float>(std::sin(lat));
+}
+}
+
+///
+/// Index file layout: Header | Node[numNodes] | names (UTF-8, null-terminated)
+///
+struct Gazetteer::Header
+{
+    char    magic[8];
+    quint32 version;
+    quint32 numNodes;
+    qint64  sourceSize;
+    qint64  sourceModified;     // msecs since epoch
+    qint64  namesSize;
+};
+
+struct Gazetteer::Node
+{
+    float   position[3];
+    quint32 nameOffset;
+};
+
+Gazetteer::Gazetteer(const QString& sourceFilePath)
+    : _sourceFilePath(sourceFilePath),
+      _indexFilePath(sourceFilePath + ".kdtree")
+{
+    // Build the index only when missing or out of date
+    if (open())
+        return;
+
+    _builtIndex = build();
+    if (_builtIndex.isEmpty())
+        return;
+
+    // Map the saved index, or use the one in memory if it can't be saved, e.g., the folder is read-only
+    if (save(_builtIndex) && open())
+        _builtIndex.clear();
+    else
+        attach(reinterpret_cast<const uchar*>(_builtIndex.constData()), _builtIndex.size());
+}
+
+bool Gazetteer::isValid() const {
+    return _numNodes > 0;
+}
+
+QString Gazetteer::findPlace(double latitude, double longitude) const
+{
+    if (!isValid())
+        return {};
+
+    float position[3];
+    toUnitVector(latitude, longitude, position);
+
+    const Node* nearest = nullptr;
+    float nearestDistance = std::numeric_limits<float>::max();
+    findNearest(_nodes, _nodes + _numNodes, 0, position, nearest, nearestDistance);
+    if (nearest == nullptr || nearest->nameOffset >= _namesSize)
+        return {};
+    return QString::fromUtf8(_names + nearest->nameOffset);
+}
+
+bool Gazetteer::open()
+{
+    _indexFile.setFileName(_indexFilePath);
+    if (!_indexFile.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = _indexFile.size();
+    if (size < qint64(sizeof(Header)) || !attach(_indexFile.map(0, size), size))
+    {
+        _indexFile.close();     // also unmaps
+        return false;
+    }
+    return true;
+}
+
+bool Gazetteer::attach(const uchar* data, qint64 size)
+{
+    const QFileInfo source(_sourceFilePath);
+    const auto header = reinterpret_cast<const Header*>(data);
+    if (header == nullptr                                                       ||
+        !source.exists()                                                        ||
+        std::memcmp(header->magic, IndexMagic, sizeof(IndexMagic)) != 0        ||
+        header->version         != IndexVersion                                 ||
+        header->sourceSize      != source.size()                                ||
+        header->sourceModified  != source.lastModified().toMSecsSinceEpoch()   ||
+        qint64(sizeof(Header)) + qint64(header->numNodes) * qint64(sizeof(Node)) + header->namesSize != size)
+        return false;
+
+    _nodes      = reinterpret_cast<const Node*>(data + sizeof(Header));
+    _numNodes   = header->numNodes;
+    _names      = reinterpret_cast<const char*>(_nodes + _numNodes);
+    _namesSize  = header->namesSize;
+    return true;
+}
+
+QByteArray Gazetteer::build() const
+{
+    QFile source(_sourceFilePath);
+    if (!source.open(QIODevice::ReadOnly))
+        return {};
+
+    // GeoNames columns: id, name, ascii name, alternate names, latitude, longitude, ...
+    std::vector<Node> nodes;
+    QByteArray names;
+    while (!source.atEnd())
+    {
+        const QList<QByteArray> fields = source.readLine().split('\t');
+        if (fields.count() < 6 || fields.at(1).isEmpty())
+            continue;
+
+        bool latitudeOk = false, longitudeOk = false;
+        const double latitude  = fields.at(4).toDouble(&latitudeOk);
+        const double longitude = fields.at(5).toDouble(&longitudeOk);
+        if (!latitudeOk || !longitudeOk)
+            continue;
+
+        Node node;
+        toUnitVector(latitude, longitude, node.position);
+        node.nameOffset = static_cast<quint32>(names.size());
+        nodes.push_back(node);
+        names.append(fields.at(1));
+        names.append('\0');
+    }
+    if (nodes.empty())
+        return {};
+
+    buildTree(nodes.data(), nodes.data() + nodes.size(), 0);
+
+    const QFileInfo sourceInfo(_sourceFilePath);
+    Header header;
+    std::memcpy(header.magic, IndexMagic, sizeof(IndexMagic));
+    header.version          = IndexVersion;
+    header.numNodes         = static_cast<quint32>(nodes.size());
+    header.sourceSize       = sourceInfo.size();
+    header.sourceModified   = sourceInfo.lastModified().toMSecsSinceEpoch();
+    header.namesSize        = names.size();
+
+    QByteArray index;
+    index.reserve(static_cast<int>(sizeof(Header) + nodes.size() * sizeof(Node)) + names.size());
+    index.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+    index.append(reinterpret_cast<const char*>(nodes.data()), static_cast<int>(nodes.size() * sizeof(Node)));
+    index.append(names);
+    return index;
+}
+
+bool Gazetteer::save(const QByteArray& index) const
+{
+    // Written to a temporary file first, so that a concurrent open never sees it half-written
+    QSaveFile file(_indexFilePath);
+    return file.open(QIODevice::WriteOnly) && file.write(index) == index.size() && file.commit();
+}
+
+void Gazetteer::buildTree(Node* begin, Node* end, int axis)
+{
+    if (end - begin <= 1)
+        return;
+
+    Node* median = begin + (end - begin) / 2;
+    std::nth_element(begin, median, end, [axis](const Node& lhs, const Node& rhs) {
+        return lhs.position[axis] < rhs.position[axis];
+    });
+    buildTree(begin, median, (axis + 1) % 3);
+    buildTree(median + 1, end, (axis + 1) % 3);
+}
+
+void Gazetteer::findNearest(const Node* begin, const Node* end, int axis, const float position[3],
+                            const Node*& nearest, float& nearestDistance)
+{
+    if (begin >= end)
+        return;
+
+    const Node* median = begin + (end - begin) / 2;
+    float distance = 0;
+    for (int i = 0; i < 3; ++i)
+        distance += (median->position[i] - position[i]) * (median->position[i] - position[i]);
+    if (distance < nearestDistance)
+    {
+        nearest = median;
+        nearestDistance = distance;
+    }
+
+    // Search the side of the position first, the other side only if it may be nearer
+    const float offset = position[axis] - median->position[axis];
+    const int nextAxis = (axis + 1) % 3;
+    if (offset < 0)
+    {
+        findNearest(begin, median, nextAxis, position, nearest, nearestDistance);
+        if (offset * offset < nearestDistance)
+            findNearest(median + 1, end, nextAxis, position, nearest, nearestDistance);
+    }
+    else
+    {
+        findNearest(median + 1, end, nextAxis, position, nearest, nearestDistance);
+        if (offset * offset < nearestDistance)
+            findNearest(begin, median, nextAxis, position, nearest, nearestDistance);
+    }
+}
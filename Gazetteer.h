@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+///
+/// @brief Offline reverse geocoding: finds the nearest place to a GPS position
+///
+/// The source is a GeoNames dump (e.g., cities1000.txt, tab-separated). It is built once
+/// into a k-d tree index next to it, which is memory-mapped afterwards. If the index
+/// can't be saved, the one just built is used from memory.
+/// Thread-safe for lookups.
+///
+class Gazetteer
+{
+public:
+    explicit Gazetteer(const QString& sourceFilePath);
+
+    bool isValid() const;
+
+    /**
+     * @brief Find the nearest place
+     * @param latitude  - in decimal degrees
+     * @param longitude - in decimal degrees
+     * @return          - name of the place, empty if the gazetteer is invalid
+     */
+    QString findPlace(double latitude, double longitude) const;
+
+private:
+    struct Header;
+    struct Node;
+
+    bool open();
+    bool attach(const uchar* data, qint64 size);    // validates the index and points into it
+    QByteArray build() const;
+    bool save(const QByteArray& index) const;
+
+    // Arrange the nodes as an implicit k-d tree, the median of each range being its root
+    static void buildTree(Node* begin, Node* end, int axis);
+    static void findNearest(const Node* begin, const Node* end, int axis, const float position[3],
+                            const Node*& nearest, float& nearestDistance);
+
+private:
+    QString     _sourceFilePath;
+    QString     _indexFilePath;
+    QFile       _indexFile;
+    QByteArray  _builtIndex;    // only when the index couldn't be saved
+
+    // Mapped or built index
+    const Node* _nodes{nullptr};
+    quint32     _numNodes{0};
+    const char* _names{nullptr};
+    qint64      _namesSize{0};
+};
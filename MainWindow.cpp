@@ -10,28 +10,82 @@
 #include <QMimeData>
 #include <QProcess>
 #include <QtConcurrent>
+#include <QThread>
 #include <QThreadPool>
+#include <QScrollBar>
+
+namespace {
+constexpr auto ExifDateColor = Qt::darkGreen;
+constexpr auto ModifiedDateColor = Qt::blue;
+constexpr auto GuessedDateColor = Qt::darkYellow;
+constexpr int PreviewBatchSize = 1000;
+constexpr int ApplyLoadedInterval = 100;  // ms
+constexpr int MaxMetadataThreads = 4;     // mostly waiting on disks and exiftool
+const QString DateTimeFormat = "yyyy-MM-dd HH:mm:ss";
+}
 
 Exif exifRunner(const QString& filePath)
 {
     return Exif(filePath);
 };
 
-ExifLoaderThread::ExifLoaderThread(const QString &filePath) : _filePath(filePath)
+ExifLoaderThread::ExifLoaderThread(const std::shared_ptr<MetadataQueue>& queue,
+                                   const std::shared_ptr<MetadataLoader>& loader)
+    : _queue(queue), _loader(loader)
 {
 }
 
-//////////////////////////////////////////////////////////////////////////////////
+PreviewThread::PreviewThread(int previewId, const QStringList& filePaths, const QStringList& dates,
+                             const QList<QPointF>& positions, const std::shared_ptr<std::atomic_bool>& cancelled)
+    : _previewId(previewId), _filePaths(filePaths), _dates(dates), _positions(positions), _cancelled(cancelled)
+{
+}
 
-namespace {
-constexpr auto ExifDateColor = Qt::darkGreen;
-constexpr auto ModifiedDateColor = Qt::blue;
+void PreviewThread::run()
+{
+    // Sort by date, the same (stable) order as sorting the view by COL_DATE
+    QList<int> order;
+    order.reserve(_filePaths.count());
+    for (int i = 0; i < _filePaths.count(); ++i)
+        order << i;
+    std::stable_sort(order.begin(), order.end(), [this](int lhs, int rhs) {
+        return _dates.at(lhs) < _dates.at(rhs);
+    });
+
+    QFileInfoList fileInfos;
+    QList<QDateTime> dateTimes;
+    QList<QPointF> positions;
+    fileInfos.reserve(order.count());
+    dateTimes.reserve(order.count());
+    positions.reserve(order.count());
+    for (int i: order)
+    {
+        fileInfos << QFileInfo(_filePaths.at(i));
+        dateTimes << QVariant(_dates.at(i)).toDateTime();
+        positions << _positions.at(i);
+    }
+
+    // The settings of the GUI thread can't be shared
+    QSettings settings("Settings.ini", QSettings::IniFormat);
+    Renamer().run(&settings, fileInfos, dateTimes, positions, PreviewBatchSize,
+                  [this, &order](int first, const QStringList& newFilePaths) {
+        if (*_cancelled)
+            return false;
+        emit batchReady(_previewId, order.mid(first, newFilePaths.count()), newFilePaths);
+        return true;
+    });
+    emit finished(_previewId, !*_cancelled);
 }
 
+//////////////////////////////////////////////////////////////////////////////////
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
-    _settings("Settings.ini", QSettings::IniFormat)
+    _filterModel(&_fileIndex),
+    _settings("Settings.ini", QSettings::IniFormat),
+    _metadataLoader(std::make_shared<MetadataLoader>()),
+    _metadataQueue(std::make_shared<MetadataQueue>())
 {
     ui->setupUi(this);
     setAcceptDrops(true);
@@ -48,12 +102,24 @@ MainWindow::MainWindow(QWidget *parent) :
     statusBar()->addPermanentWidget(_progressBar);
     _progressBar->hide();
 
+    // Preview and moving have their own, files may be added and loaded meanwhile
+    _previewProgressBar = new QProgressBar(this);
+    _previewProgressBar->setFormat(tr("Preview %v/%m"));
+    statusBar()->addPermanentWidget(_previewProgressBar);
+    _previewProgressBar->hide();
+
+    _moveProgressBar = new QProgressBar(this);
+    _moveProgressBar->setFormat(tr("Moving %v/%m"));
+    statusBar()->addPermanentWidget(_moveProgressBar);
+    _moveProgressBar->hide();
+
     updateActions();
 
     _model.setColumnCount(5);
     _model.setHorizontalHeaderLabels(QStringList{"From", "To", "Date", "Modified Date", "Exif Date"});
 
-    ui->tableView->setModel(&_model);
+    _filterModel.setSourceModel(&_model);
+    ui->tableView->setModel(&_filterModel);
     ui->tableView->sortByColumn(COL_DATE, Qt::AscendingOrder);
 
     onSelectionChanged(QItemSelection());
@@ -69,12 +135,32 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->actionAbout,        SIGNAL(triggered()), SLOT(onAbout()));
     connect(ui->tableView->selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)),
             SLOT(onSelectionChanged(QItemSelection)));
+    connect(ui->leFilter, &QLineEdit::textChanged, this, &MainWindow::onFilterChanged);
+
+    // Load the metadata of the visible rows first
+    connect(ui->tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::prioritizeVisible);
+    connect(&_filterModel, &FileFilterModel::layoutChanged, this, &MainWindow::prioritizeVisible);
+
+    _metadataPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, MaxMetadataThreads));
+
+    _applyTimer.setSingleShot(true);
+    _applyTimer.setInterval(ApplyLoadedInterval);
+    connect(&_applyTimer, &QTimer::timeout, this, &MainWindow::applyLoaded);
+
+    connect(&_moveWatcher, &QFutureWatcher<QList<FileMover::Result>>::progressValueChanged,
+            _moveProgressBar, &QProgressBar::setValue);
+    connect(&_moveWatcher, &QFutureWatcher<QList<FileMover::Result>>::finished,
+            this, &MainWindow::onMoveFinished);
 
     // For queued signal across threads
     qRegisterMetaType<Exif>("Exif");
+    qRegisterMetaType<QList<int>>("QList<int>");
 }
 
-MainWindow::~MainWindow() {
+MainWindow::~MainWindow()
+{
+    cancelPreview();
+    _metadataQueue->clear();
     delete ui;
 }
 
@@ -95,61 +181,128 @@ void MainWindow::dropEvent(QDropEvent* e)
 
 void ExifLoaderThread::run()
 {
-    emit resultReady(Exif(_filePath));
+    // Background work, the GUI, preview and moves go first
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+
+    QString filePath;
+    while (_queue->take(filePath))
+        emit resultReady(_loader->load(filePath, MetadataProvider::CreationDate));
 }
 
 void MainWindow::onExifLoaded(const Exif& exif)
 {
-    const QString dateTimeFormat = "yyyy-MM-dd HH:mm:ss";
+    // Apply in batches, so that the columns are resized and progress updated once per batch
+    _loadedExifs << exif;
+    if (!_applyTimer.isActive())
+        _applyTimer.start();
+}
+
+void MainWindow::applyLoaded()
+{
     const QSet<QString> videoFileExtensions{"mp4", "mov"};
 
-    QMutexLocker lock(&_mutex);
+    for (const Exif& exif: qAsConst(_loadedExifs))
+    {
+        // The row may have been removed meanwhile
+        const auto filePath = exif.getFilePath();
+        QStandardItem* item = _loadingItems.take(filePath);
+        if (item == nullptr)
+            continue;
 
-    int row = _model.rowCount();
-    _model.insertRow(row);
+        const int row   = item->row();
+        const int rowId = getRowId(row);
 
-    const auto filePath = exif.getFilePath();
-    _model.setData(_model.index(row, COL_FROM), QDir::toNativeSeparators(filePath));
+        // For $place$
+        double latitude, longitude;
+        if (exif.getGpsPosition(latitude, longitude))
+            _model.setData(_model.index(row, COL_FROM), QPointF(latitude, longitude), GpsRole);
 
-    QDateTime lastModifiedDateTime = QFileInfo(filePath).lastModified();
-    _model.setData(_model.index(row, COL_MODIFIED_DATE), lastModifiedDateTime.toString(dateTimeFormat));
-    _model.setData(_model.index(row, COL_MODIFIED_DATE), QColor(ModifiedDateColor), Qt::ForegroundRole);
+        // fuzzy search for "create time" in exif
+        QString exifDateString = exif.getValue(QStringList{"Create", "Creation"}, true);
 
-    // fuzzy search for "create time" in exif
-    QString exifDateString = exif.getValue(QStringList{"Create", "Creation"}, true);
+        // Capture the useful part of the date string
+        QRegularExpression regex(R"(\d+:\d+:\d+\s+\d+:\d+:\d+)");
+        QRegularExpressionMatch match = regex.match(exifDateString);
+        if (!match.hasMatch())
+        {
+            // Without EXIF, fall back to a guess, e.g., from the file name, shown in its own color
+            const QDateTime guessedDateTime = QDateTime::fromString(
+                        exif.getValue(FileNameProvider::GuessedDateProperty), "yyyy:MM:dd hh:mm:ss");
+            if (guessedDateTime.isValid())
+            {
+                _fileIndex.setGuessedDate(rowId, guessedDateTime);
+                _fileIndex.setDateSource(rowId, FileIndex::GuessedDate);
+                _model.setData(_model.index(row, COL_DATE), guessedDateTime.toString(DateTimeFormat));
+                _model.setData(_model.index(row, COL_DATE), QColor(GuessedDateColor), Qt::ForegroundRole);
+            }
+            continue;
+        }
+        const auto exifDateStringCaptured = match.captured(0);
 
-    // Capture the useful part of the date string
-    QRegularExpression regex(R"(\d+:\d+:\d+\s+\d+:\d+:\d+)");
-    QRegularExpressionMatch match = regex.match(exifDateString);
-    if (!match.hasMatch()) {
-        return;
+        // Set exif date
+        QDateTime exifDateTime = QDateTime::fromString(exifDateStringCaptured, "yyyy:MM:dd hh:mm:ss");
+        if (!exifDateTime.isValid())    // e.g., 0000:00:00 00:00:00 written by some cameras
+            continue;
+        _fileIndex.setExifDate(rowId, exifDateTime);
+        _model.setData(_model.index(row, COL_EXIF_DATE), exifDateTime.toString(DateTimeFormat));
+        _model.setData(_model.index(row, COL_EXIF_DATE), QColor(ExifDateColor), Qt::ForegroundRole);
+
+        // Use modified date for video files
+        if (videoFileExtensions.contains(QFileInfo(filePath).suffix()))
+        {
+            applyModifiedDate(row);
+        }
+        else
+        {
+            applyExifDate(row);
+        }
     }
-    const auto exifDateStringCaptured = match.captured(0);
+    _loadedExifs.clear();
 
-    // Set exif date
-    QDateTime exifDateTime = QDateTime::fromString(exifDateStringCaptured, "yyyy:MM:dd hh:mm:ss");
-    _model.setData(_model.index(row, COL_EXIF_DATE), exifDateTime.toString(dateTimeFormat));
-    _model.setData(_model.index(row, COL_EXIF_DATE), QColor(ExifDateColor), Qt::ForegroundRole);
+    // Re-filter and re-sort once per batch
+    _filterModel.refresh();
+    ui->tableView->resizeColumnsToContents();
+    updateLoadingProgress();
+}
 
-    // Use modified date for video files
-    if (videoFileExtensions.contains(QFileInfo(filePath).suffix()))
-    {
-        applyModifiedDate(row);
-    }
-    else
+void MainWindow::updateLoadingProgress()
+{
+    _progressBar->setValue(_progressBar->maximum() - _loadingItems.count());
+    if (!_loadingItems.isEmpty())
+        return;
+
+    _progressBar->hide();
+    statusBar()->showMessage(_metadataLoader->getStatistics());
+    ui->tableView->sortByColumn(COL_DATE, Qt::AscendingOrder);
+    updateActions();
+
+    if (_previewAfterLoading)
     {
-        applyExifDate(row);
+        _previewAfterLoading = false;
+        preview();
     }
+}
 
-    --_numLoadingFiles;
-    _progressBar->setValue(_progressBar->maximum() - _numLoadingFiles);
-    ui->tableView->resizeColumnsToContents();
-    if (_numLoadingFiles == 0)
+void MainWindow::prioritizeVisible()
+{
+    if (_loadingItems.isEmpty())
+        return;
+
+    const int first = ui->tableView->rowAt(0);
+    int last = ui->tableView->rowAt(ui->tableView->viewport()->height() - 1);
+    if (first < 0)
+        return;
+    if (last < 0)
+        last = _filterModel.rowCount() - 1;
+
+    QStringList filePaths;
+    for (int row = first; row <= last; ++row)
     {
-        _progressBar->hide();
-        ui->tableView->sortByColumn(COL_DATE, Qt::AscendingOrder);
-        updateActions();
+        const QString filePath = QDir::fromNativeSeparators(_filterModel.index(row, COL_FROM).data().toString());
+        if (_loadingItems.contains(filePath))
+            filePaths << filePath;
     }
+    _metadataQueue->prioritize(filePaths);
 }
 
 void MainWindow::addFiles(const QStringList& filePaths)
@@ -164,21 +317,49 @@ void MainWindow::addFiles(const QStringList& filePaths)
             newFiles << filePath;
         }
     }
-    _numLoadingFiles = newFiles.count();
-    if (_numLoadingFiles == 0)
+    if (newFiles.isEmpty())
         return;
 
+    if (_loadingItems.isEmpty())
+        _progressBar->setRange(0, newFiles.count());
+    else
+        _progressBar->setMaximum(_progressBar->maximum() + newFiles.count());
     _progressBar->show();
-    _progressBar->setRange(0, newFiles.count());
-    _progressBar->setValue(0);
 
-    // Start multi-threaded loading
+    // Show the rows right away with what the file system knows, the metadata comes later
+    int row = _model.rowCount();
+    _model.insertRows(row, newFiles.count());
     for (const auto& filePath: newFiles)
     {
-        auto loader = new ExifLoaderThread(filePath);
+        // Index the row before its id shows it through the filter
+        const QString nativeFilePath = QDir::toNativeSeparators(filePath);
+        const QDateTime lastModifiedDateTime = QFileInfo(filePath).lastModified();
+        const int rowId = _nextRowId++;
+        _fileIndex.addFile(rowId, nativeFilePath, lastModifiedDateTime);
+
+        auto item = new QStandardItem(nativeFilePath);
+        item->setData(rowId, FileFilterModel::RowIdRole);
+        _model.setItem(row, COL_FROM, item);
+        _model.setData(_model.index(row, COL_MODIFIED_DATE), lastModifiedDateTime.toString(DateTimeFormat));
+        _model.setData(_model.index(row, COL_MODIFIED_DATE), QColor(ModifiedDateColor), Qt::ForegroundRole);
+
+        _loadingItems.insert(filePath, item);
+        ++row;
+    }
+    _filterModel.refresh();
+    _progressBar->setValue(_progressBar->maximum() - _loadingItems.count());
+    ui->tableView->resizeColumnsToContents();
+    updateActions();
+
+    // Start multi-threaded loading
+    const int newWorkers = _metadataQueue->enqueue(newFiles, _metadataPool.maxThreadCount());
+    for (int i = 0; i < newWorkers; ++i)
+    {
+        auto loader = new ExifLoaderThread(_metadataQueue, _metadataLoader);
         connect(loader, &ExifLoaderThread::resultReady, this, &MainWindow::onExifLoaded);
-        QThreadPool::globalInstance()->start(loader);
+        _metadataPool.start(loader);
     }
+    prioritizeVisible();
 }
 
 void MainWindow::onAdd()
@@ -194,13 +375,39 @@ void MainWindow::onDel()
     QList<int> rows;
     for (const QModelIndex& idx: getSelected())
         rows.append(idx.row());
+    removeRows(rows);
+}
 
+void MainWindow::removeRows(QList<int> rows)
+{
+    // Selections list every column of a row
     std::sort(std::begin(rows), std::end(rows), std::greater<int>());
-    for (int row: rows)
+    rows.erase(std::unique(std::begin(rows), std::end(rows)), std::end(rows));
+
+    const bool wasLoading = !_loadingItems.isEmpty();
+    for (int row: qAsConst(rows))
     {
+        _fileIndex.removeFile(getRowId(row));
         _filePaths.remove(_model.data(_model.index(row, COL_FROM)).toString());
-        _model.removeRow(row);
+
+        // The loaders must not see the removed row
+        const QString filePath = QDir::fromNativeSeparators(_model.data(_model.index(row, COL_FROM)).toString());
+        _loadingItems.remove(filePath);
+        _metadataQueue->remove(filePath);
+    }
+
+    // One removal per contiguous range, from the bottom up
+    for (int i = 0; i < rows.count(); )
+    {
+        int first = rows.at(i++);
+        const int last = first;
+        while (i < rows.count() && rows.at(i) == first - 1)
+            first = rows.at(i++);
+        _model.removeRows(first, last - first + 1);
     }
+
+    if (wasLoading)
+        updateLoadingProgress();
 }
 
 void MainWindow::applyModifiedDate(int row)
@@ -208,6 +415,7 @@ void MainWindow::applyModifiedDate(int row)
     QString date = _model.data(_model.index(row, COL_MODIFIED_DATE)).toString();
     if (!date.isEmpty())
     {
+        _fileIndex.setDateSource(getRowId(row), FileIndex::ModifiedDate);
         _model.setData(_model.index(row, COL_DATE), date);
 
         // Highlight when different
@@ -223,6 +431,7 @@ void MainWindow::applyExifDate(int row)
     QString date = _model.data(_model.index(row, COL_EXIF_DATE)).toString();
     if (!date.isEmpty())
     {
+        _fileIndex.setDateSource(getRowId(row), FileIndex::ExifDate);
         _model.setData(_model.index(row, COL_DATE), date);
 
         // Highlight when different
@@ -240,6 +449,7 @@ void MainWindow::onUseModified()
     {
         applyModifiedDate(idx.row());
     }
+    _filterModel.refresh();
 }
 
 void MainWindow::onUseExif()
@@ -248,33 +458,91 @@ void MainWindow::onUseExif()
     {
         applyExifDate(idx.row());
     }
+    _filterModel.refresh();
 }
 
 /**
  * Pre-run the renaming
  * Put result under COL_TO without actually running it
+ * Runs on a snapshot of the model in the background, filling COL_TO as batches finish
  */
 void MainWindow::preview()
 {
-    // collect input
-    ui->tableView->sortByColumn(COL_DATE, Qt::AscendingOrder);
+    cancelPreview();
 
-    QFileInfoList fileInfos;
-    QList<QDateTime> dateTimes;
+    // Every date is needed, wait for the metadata
+    if (!_loadingItems.isEmpty())
+    {
+        _previewAfterLoading = true;
+        statusBar()->showMessage(tr("Preview will start when the metadata is loaded"));
+        updateActions();
+        return;
+    }
+
+    // snapshot the input
+    QStringList filePaths;
+    QStringList dates;
+    QList<QPointF> positions;
     for(int row = 0; row < _model.rowCount(); ++row)
     {
-        fileInfos << QFileInfo(_model.data(_model.index(row, COL_FROM)).toString());
-        dateTimes << _model.data(_model.index(row, COL_DATE)).toDateTime();
+        const QVariant position = _model.data(_model.index(row, COL_FROM), GpsRole);
+        filePaths << _model.data(_model.index(row, COL_FROM)).toString();
+        dates     << _model.data(_model.index(row, COL_DATE)).toString();
+        positions << (position.isValid() ? position.toPointF() : QPointF(qQNaN(), qQNaN()));
+        _previewTargets << QPersistentModelIndex(_model.index(row, COL_TO));
     }
 
-    // get results
-    QStringList newFilePaths = Renamer().run(&_settings, fileInfos, dateTimes);
+    _previewProgressBar->show();
+    _previewProgressBar->setRange(0, filePaths.count());
+    _previewProgressBar->setValue(0);
+    updateActions();
 
-    // write results to COL_TO
-    for(int row = 0; row < _model.rowCount(); ++row)
-        _model.setData(_model.index(row, COL_TO), newFilePaths.at(row));
+    _previewCancelled = std::make_shared<std::atomic_bool>(false);
+    auto previewer = new PreviewThread(_previewId, filePaths, dates, positions, _previewCancelled);
+    connect(previewer, &PreviewThread::batchReady, this, &MainWindow::onPreviewBatch);
+    connect(previewer, &PreviewThread::finished,   this, &MainWindow::onPreviewFinished);
+    QThreadPool::globalInstance()->start(previewer);
+}
+
+void MainWindow::cancelPreview()
+{
+    if (_previewCancelled)
+        *_previewCancelled = true;
+    ++_previewId;   // results of the cancelled preview will be ignored
+    _previewTargets.clear();
+    _previewProgressBar->hide();
+}
+
+void MainWindow::onPreviewBatch(int previewId, const QList<int>& rows, const QStringList& newFilePaths)
+{
+    if (previewId != _previewId)
+        return;
 
+    // write results to COL_TO, skipping rows removed in the meantime
+    for (int i = 0; i < rows.count(); ++i)
+    {
+        const QPersistentModelIndex& idx = _previewTargets.at(rows.at(i));
+        if (idx.isValid())
+            _model.setData(idx, newFilePaths.at(i));
+    }
+    _previewProgressBar->setValue(_previewProgressBar->value() + rows.count());
+}
+
+void MainWindow::onPreviewFinished(int previewId, bool completed)
+{
+    if (previewId != _previewId)
+        return;
+
+    const bool renameAfterPreview = _renameAfterPreview;
+    _previewTargets.clear();
+    _renameAfterPreview = false;
+    _previewProgressBar->hide();
+    _filterModel.refresh();     // in case the view is sorted by COL_TO
     ui->tableView->resizeColumnsToContents();
+    updateActions();
+
+    if (completed && renameAfterPreview)
+        onRename();
 }
 
 /**
@@ -289,14 +557,15 @@ void MainWindow::onRename()
         if (dlg.exec() == QDialog::Accepted)
         {
             preview();
-            if (dlg.getActionCode() == DlgSettings::PREVIEW)    // user selected preview
-                return;
+
+            // Rename when the preview finishes, unless user selected preview
+            _renameAfterPreview = dlg.getActionCode() == DlgSettings::RENAME;
         }
-        else
-            return;
+        return;
     }
 
     // Acturally run renaming based on previewed results
+    QList<FileMover::Job> jobs;
     for(int row = 0; row < _model.rowCount(); ++row)
     {
         QString from = _model.data(_model.index(row, COL_FROM)).toString();
@@ -313,16 +582,68 @@ void MainWindow::onRename()
             QProcess::execute("touch", QStringList() << "-t" << dateTime.toString("yyyyMMddhhmm") << from);
         }
 
-        QFile::rename(from, to);
+        jobs << FileMover::Job{from, to};
     }
 
-    onClean();
+    // Move in batches on the thread pool, files on other devices are copied and verified
+    const auto batches = FileMover::makeBatches(jobs);
+    _moveProgressBar->show();
+    _moveProgressBar->setRange(0, batches.count());
+    _moveProgressBar->setValue(0);
+    ui->actionRename->setEnabled(false);
+    _moveWatcher.setFuture(QtConcurrent::mapped(batches, &FileMover::moveBatch));
+}
+
+void MainWindow::onMoveFinished()
+{
+    _moveProgressBar->hide();
+
+    QSet<QString> movedFiles;
+    QStringList errors;
+    for (const auto& results: _moveWatcher.future().results())
+        for (const auto& result: results)
+        {
+            if (result.error.isEmpty())
+            {
+                movedFiles << result.from;
+                _metadataLoader->move(result.from, result.to);  // the cache follows the file
+            }
+            else
+                errors << result.error;
+        }
+
+    // Remove the moved files, keeping the failed ones and those added during the move
+    QList<int> movedRows;
+    for(int row = 0; row < _model.rowCount(); ++row)
+        if (movedFiles.contains(_model.data(_model.index(row, COL_FROM)).toString()))
+            movedRows << row;
+
+    if (movedRows.count() == _model.rowCount())
+        onClean();
+    else
+        removeRows(movedRows);
+    updateActions();
+
+    if (!errors.isEmpty())
+        QMessageBox::warning(this, tr("Rename"),
+                             tr("%1 file(s) could not be renamed:\n%2").arg(errors.count()).arg(errors.join("\n")));
 }
 
 void MainWindow::onClean()
 {
+    cancelPreview();
+    _renameAfterPreview  = false;
+    _previewAfterLoading = false;
+
+    _metadataQueue->clear();
+    _loadingItems.clear();
+    _loadedExifs.clear();
+    _progressBar->hide();
+
     _model.removeRows(0, _model.rowCount());
     _filePaths.clear();
+    _fileIndex.clear();
+    _nextRowId = 0;
     updateActions();
 }
 
@@ -358,13 +679,29 @@ void MainWindow::onFixDate()
     }
 }
 
-QModelIndexList MainWindow::getSelected() const {
-    return ui->tableView->selectionModel()->selectedIndexes();
+QModelIndexList MainWindow::getSelected() const
+{
+    // Selection is on the filtered view, map it to the model
+    QModelIndexList result;
+    for (const QModelIndex& idx: ui->tableView->selectionModel()->selectedIndexes())
+        result << _filterModel.mapToSource(idx);
+    return result;
+}
+
+int MainWindow::getRowId(int row) const {
+    return _model.data(_model.index(row, COL_FROM), FileFilterModel::RowIdRole).toInt();
+}
+
+void MainWindow::onFilterChanged(const QString& query)
+{
+    if (_fileIndex.setQuery(query))
+        _filterModel.refresh();
 }
 
 void MainWindow::updateActions()
 {
     ui->actionEmpty  ->setEnabled(_model.rowCount() > 0);
-    ui->actionRename ->setEnabled(_model.rowCount() > 0);
+    ui->actionRename ->setEnabled(_model.rowCount() > 0 && _loadingItems.isEmpty() && _previewTargets.isEmpty() &&
+                                   !_previewAfterLoading && !_moveWatcher.isRunning());
     ui->actionFixDate->setEnabled(_model.rowCount() > 0);
 }
@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Exif.h"
+#include "FileFilterModel.h"
+#include "FileIndex.h"
+#include "FileMover.h"
+#include "MetadataLoader.h"
+#include "MetadataQueue.h"
 #include <QMainWindow>
 #include <QSet>
 #include <QSettings>
@@ -8,6 +13,12 @@
 #include <QFutureWatcher>
 #include <QRunnable>
 #include <QObject>
+#include <QPersistentModelIndex>
+#include <QPointF>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <memory>
 
 namespace Ui {
 class MainWindow;
@@ -16,19 +27,48 @@ class MainWindow;
 class QProgressBar;
 class QItemSelection;
 
+///
+/// @brief Loads the metadata of the files in the queue until it's empty
+///
 class ExifLoaderThread : public QObject, public QRunnable
 {
     Q_OBJECT
 
 public:
-    ExifLoaderThread(const QString& filePath);
+    ExifLoaderThread(const std::shared_ptr<MetadataQueue>& queue, const std::shared_ptr<MetadataLoader>& loader);
     void run() override;
 
 signals:
     void resultReady(const Exif& exif);
 
 private:
-    QString _filePath;
+    std::shared_ptr<MetadataQueue>  _queue;
+    std::shared_ptr<MetadataLoader> _loader;
+};
+
+///
+/// @brief Runs the renaming on a snapshot of the files, reporting the new names in batches
+///
+class PreviewThread : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    PreviewThread(int previewId, const QStringList& filePaths, const QStringList& dates,
+                  const QList<QPointF>& positions, const std::shared_ptr<std::atomic_bool>& cancelled);
+    void run() override;
+
+signals:
+    // rows are indices into the snapshot
+    void batchReady(int previewId, const QList<int>& rows, const QStringList& newFilePaths);
+    void finished(int previewId, bool completed);
+
+private:
+    int         _previewId;
+    QStringList _filePaths;
+    QStringList _dates;
+    QList<QPointF> _positions;
+    std::shared_ptr<std::atomic_bool> _cancelled;
 };
 
 class MainWindow : public QMainWindow
@@ -55,28 +95,69 @@ private slots:
     void onSelectionChanged(const QItemSelection& selection);
     void onFixDate();
     void onExifLoaded(const Exif& exif);
+    void onMoveFinished();
+    void onPreviewBatch(int previewId, const QList<int>& rows, const QStringList& newFilePaths);
+    void onPreviewFinished(int previewId, bool completed);
+    void onFilterChanged(const QString& query);
+    void applyLoaded();
+    void prioritizeVisible();
 
 private:
     void addFiles(const QStringList& filePaths);
+    void removeRows(QList<int> rows);   // rows of _model
     void preview();
+    void cancelPreview();
     void updateActions();
     QModelIndexList getSelected() const;
+    int getRowId(int row) const;
     void applyModifiedDate(int row);
     void applyExifDate(int row);
+    void updateLoadingProgress();
 
 private:
     enum {COL_FROM, COL_TO, COL_DATE, COL_MODIFIED_DATE, COL_EXIF_DATE};
 
+    // Role in COL_FROM holding the GPS position (x: latitude, y: longitude)
+    enum {GpsRole = FileFilterModel::RowIdRole + 1};
+
     Ui::MainWindow* ui;
     QStandardItemModel  _model;
-    QProgressBar*       _progressBar;
+    FileIndex           _fileIndex;
+    FileFilterModel     _filterModel;
+    QProgressBar*       _progressBar;       // loading
+    QProgressBar*       _previewProgressBar;
+    QProgressBar*       _moveProgressBar;
     QSettings           _settings;
 
     QSet<QString>       _filePaths;
 
-    // Number of files that are currently being loaded
-    int _numLoadingFiles{0};
+    // Shared with the loader threads, which may outlive the window
+    std::shared_ptr<MetadataLoader> _metadataLoader;
+    std::shared_ptr<MetadataQueue>  _metadataQueue;
+
+    // COL_FROM items of the rows waiting for metadata, by file path
+    QHash<QString, QStandardItem*> _loadingItems;
+
+    // Loaded metadata, applied to the model in batches
+    QList<Exif> _loadedExifs;
+    QTimer      _applyTimer;
+
+    // Preview requested while loading
+    bool _previewAfterLoading{false};
+
+    // Id of the next row added to the index
+    int _nextRowId{0};
+
+    // Preview in progress: id of the latest preview, its cancellation flag, and COL_TO of the snapshot rows
+    int _previewId{0};
+    std::shared_ptr<std::atomic_bool> _previewCancelled;
+    QList<QPersistentModelIndex> _previewTargets;
+    bool _renameAfterPreview{false};
+
+    // Moves the renamed files in batches
+    QFutureWatcher<QList<FileMover::Result>> _moveWatcher;
 
-    // Single-threaded writing into the model
-    QMutex _mutex;
+    // Runs the loader threads, leaving the global pool to preview and moves.
+    // Last, so that it waits for the loaders before anything else is destroyed
+    QThreadPool _metadataPool;
 };
@@ -0,0 +1,83 @@
+#include "MetadataLoader.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QStringList>
+#include <algorithm>
+
+MetadataLoader::MetadataLoader()
+{
+    addProvider(std::make_unique<CacheProvider>("MetadataCache.dat"));
+    addProvider(std::make_unique<ExifParserProvider>());
+    addProvider(std::make_unique<ExiftoolProvider>());
+    addProvider(std::make_unique<FileNameProvider>());
+}
+
+void MetadataLoader::addProvider(std::unique_ptr<MetadataProvider> provider)
+{
+    _slots.push_back(Slot{std::move(provider), std::make_unique<Statistics>()});
+
+    // Guesses last, then the cheapest first
+    std::stable_sort(_slots.begin(), _slots.end(), [](const Slot& lhs, const Slot& rhs) {
+        if (lhs.provider->isGuess() != rhs.provider->isGuess())
+            return rhs.provider->isGuess();
+        return lhs.provider->getCost() < rhs.provider->getCost();
+    });
+}
+
+Exif MetadataLoader::load(const QString& filePath, MetadataProvider::Fields fields)
+{
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    for (const auto& slot: _slots)
+    {
+        MetadataProvider* provider = slot.provider.get();
+        if (!provider->canHandle(suffix) || (provider->getFields() & fields) != fields)
+            continue;
+
+        Exif exif;
+        exif.setFilePath(filePath);
+        QElapsedTimer timer;
+        timer.start();
+        const bool hit = provider->load(filePath, fields, exif);
+        slot.statistics->nanoseconds += timer.nsecsElapsed();
+        slot.statistics->attempts++;
+        if (!hit)
+            continue;
+
+        // Let the others, e.g., the cache, remember it. Guesses are not worth remembering
+        slot.statistics->hits++;
+        if (!provider->isGuess())
+            for (const auto& other: _slots)
+                if (other.provider.get() != provider)
+                    other.provider->store(filePath, fields, exif);
+        return exif;
+    }
+
+    Exif exif;
+    exif.setFilePath(filePath);
+    return exif;
+}
+
+void MetadataLoader::move(const QString& from, const QString& to)
+{
+    for (const auto& slot: _slots)
+        slot.provider->move(from, to);
+}
+
+QString MetadataLoader::getStatistics() const
+{
+    QStringList result;
+    for (const auto& slot: _slots)
+    {
+        const int attempts = slot.statistics->attempts;
+        if (attempts == 0)
+            continue;
+
+        const int hits = slot.statistics->hits;
+        const double averageMs = slot.statistics->nanoseconds / 1e6 / attempts;
+        result << QString("%1: %2/%3 hits, %4 ms avg").arg(slot.provider->getName())
+                                                      .arg(hits).arg(attempts)
+                                                      .arg(averageMs, 0, 'f', 2);
+    }
+    return result.join(" | ");
+}
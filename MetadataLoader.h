@@ -0,0 +1,53 @@
+#pragma once
+
+#include "MetadataProvider.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+///
+/// @brief Loads metadata from the cheapest provider that can answer the requested fields
+///
+/// Providers are tried in the order of their cost, guesses last. Thread-safe once
+/// all providers are added.
+///
+class MetadataLoader
+{
+public:
+    MetadataLoader();
+
+    void addProvider(std::unique_ptr<MetadataProvider> provider);
+
+    /**
+     * @brief Load the metadata of a file
+     * @param filePath  - the file
+     * @param fields    - requested fields
+     * @return          - the metadata, with only the file path if no provider answered
+     */
+    Exif load(const QString& filePath, MetadataProvider::Fields fields);
+
+    /**
+     * @brief Let the providers know a file has been moved or renamed
+     */
+    void move(const QString& from, const QString& to);
+
+    // Per-provider hit rates and latencies
+    QString getStatistics() const;
+
+private:
+    struct Statistics
+    {
+        std::atomic<int>    attempts{0};
+        std::atomic<int>    hits{0};
+        std::atomic<qint64> nanoseconds{0};
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<MetadataProvider>   provider;
+        std::unique_ptr<Statistics>         statistics;
+    };
+
+    std::vector<Slot> _slots;   // in the order of trying
+};
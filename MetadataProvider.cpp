@@ -0,0 +1,334 @@
+#include "MetadataProvider.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <algorithm>
+#include <vector>
+
+namespace {
+const QSet<QString> JpegSuffixes{"jpg", "jpeg"};
+const QSet<QString> TiffSuffixes{"tif", "tiff", "dng", "nef", "cr2", "arw", "orf", "rw2", "pef"};
+
+// IFDs of raw files are near the beginning
+constexpr qint64 TiffHeaderSize = 256 * 1024;
+
+constexpr quint32     CacheVersion       = 3;        // 2: built-in parser reads GPS, 3: entries record their last use
+constexpr quint32     MaxCacheUnusedRuns = 10;
+constexpr std::size_t MaxCacheEntries    = 200000;
+
+///
+/// @brief Reads tags from a TIFF block of either byte order
+///
+class TiffReader
+{
+public:
+    explicit TiffReader(const QByteArray& data) : _data(data), _bigEndian(data.startsWith("MM")) {}
+
+    bool isValid() const {
+        return _data.startsWith(QByteArray("II*\0", 4)) || _data.startsWith(QByteArray("MM\0*", 4));
+    }
+
+    // Unsigned integer of size bytes, 0 if out of range
+    quint32 read(qint64 offset, int size) const
+    {
+        if (offset < 0 || offset + size > _data.size())
+            return 0;
+
+        quint32 result = 0;
+        for (int i = 0; i < size; ++i)
+            result = result << 8 | quint8(_data.at(static_cast<int>(offset) + (_bigEndian ? i : size - 1 - i)));
+        return result;
+    }
+
+    // Offset of the entry of a tag in an IFD, -1 if not found
+    qint64 findEntry(qint64 ifdOffset, quint16 tag) const
+    {
+        const int count = static_cast<int>(read(ifdOffset, 2));
+        for (int i = 0; i < count; ++i)
+        {
+            const qint64 entry = ifdOffset + 2 + 12 * i;
+            if (read(entry, 2) == tag)
+                return entry;
+        }
+        return -1;
+    }
+
+    // Value of an ASCII tag
+    QString readString(qint64 ifdOffset, quint16 tag) const
+    {
+        const qint64 entry = findEntry(ifdOffset, tag);
+        if (entry < 0 || read(entry + 2, 2) != 2)
+            return {};
+
+        const quint32 count = read(entry + 4, 4);
+        const qint64 offset = count <= 4 ? entry + 8 : read(entry + 8, 4);
+        if (count > 64 || offset + count > _data.size())
+            return {};
+        return QString::fromLatin1(_data.mid(static_cast<int>(offset), static_cast<int>(count)))
+                .remove(QChar('\0')).trimmed();
+    }
+
+    // Value of a tag of 3 rationals, e.g., GPS latitude, formatted as exiftool does
+    QString readDegrees(qint64 ifdOffset, quint16 tag) const
+    {
+        const qint64 entry = findEntry(ifdOffset, tag);
+        if (entry < 0 || read(entry + 2, 2) != 5 || read(entry + 4, 4) != 3)
+            return {};
+
+        const qint64 offset = read(entry + 8, 4);
+        double values[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            const quint32 numerator   = read(offset + 8 * i,     4);
+            const quint32 denominator = read(offset + 8 * i + 4, 4);
+            if (denominator == 0)
+                return {};
+            values[i] = double(numerator) / denominator;
+        }
+        return QString("%1 deg %2' %3\"").arg(values[0]).arg(values[1]).arg(values[2], 0, 'f', 2);
+    }
+
+private:
+    QByteArray  _data;
+    bool        _bigEndian;
+};
+
+// The TIFF block in the APP1 segment of a JPEG file
+QByteArray readJpegExif(QFile& file)
+{
+    if (file.read(2) != "\xFF\xD8")
+        return {};
+
+    while (!file.atEnd())
+    {
+        const QByteArray header = file.read(4);
+        if (header.size() < 4 || quint8(header.at(0)) != 0xFF)
+            return {};
+
+        const quint8 marker = quint8(header.at(1));
+        const int length = (quint8(header.at(2)) << 8 | quint8(header.at(3))) - 2;
+        if (marker == 0xDA || length < 0)  // start of scan, no more metadata
+            return {};
+
+        if (marker == 0xE1)
+        {
+            const QByteArray payload = file.read(length);
+            if (payload.startsWith(QByteArray("Exif\0\0", 6)))
+                return payload.mid(6);
+        }
+        else if (!file.seek(file.pos() + length))
+            return {};
+    }
+    return {};
+}
+
+void setIfNotEmpty(Exif& exif, const QString& property, const QString& value)
+{
+    if (!value.isEmpty())
+        exif.setValue(property, value);
+}
+}
+
+MetadataProvider::Fields MetadataProvider::findFields(const Exif& exif)
+{
+    // Same as how MainWindow finds the date
+    Fields result;
+    const QRegularExpression dateRegex(R"(\d+:\d+:\d+\s+\d+:\d+:\d+)");
+    if (dateRegex.match(exif.getValue(QStringList{"Create", "Creation"}, true)).hasMatch())
+        result |= CreationDate;
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+bool ExifParserProvider::canHandle(const QString& suffix) const {
+    return JpegSuffixes.contains(suffix) || TiffSuffixes.contains(suffix);
+}
+
+bool ExifParserProvider::load(const QString& filePath, Fields fields, Exif& exif)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    const TiffReader tiff(TiffSuffixes.contains(suffix) ? file.read(TiffHeaderSize) : readJpegExif(file));
+    if (!tiff.isValid())
+        return false;
+
+    // Use the tag names of exiftool
+    const qint64 ifd0 = tiff.read(4, 4);
+    const qint64 exifPointer = tiff.findEntry(ifd0, 0x8769);
+    if (exifPointer >= 0)
+    {
+        const qint64 exifIfd = tiff.read(exifPointer + 8, 4);
+        setIfNotEmpty(exif, "Create Date",          tiff.readString(exifIfd, 0x9004));
+        setIfNotEmpty(exif, "Date/Time Original",   tiff.readString(exifIfd, 0x9003));
+    }
+    setIfNotEmpty(exif, "Modify Date", tiff.readString(ifd0, 0x0132));
+
+    // GPS is not requested, but worth having for the $place$ token
+    const qint64 gpsPointer = tiff.findEntry(ifd0, 0x8825);
+    if (gpsPointer >= 0)
+    {
+        const qint64 gpsIfd = tiff.read(gpsPointer + 8, 4);
+        setIfNotEmpty(exif, "GPS Latitude Ref",     tiff.readString (gpsIfd, 0x0001));
+        setIfNotEmpty(exif, "GPS Latitude",         tiff.readDegrees(gpsIfd, 0x0002));
+        setIfNotEmpty(exif, "GPS Longitude Ref",    tiff.readString (gpsIfd, 0x0003));
+        setIfNotEmpty(exif, "GPS Longitude",        tiff.readDegrees(gpsIfd, 0x0004));
+    }
+
+    return (findFields(exif) & fields) == fields;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+bool ExiftoolProvider::load(const QString& filePath, Fields fields, Exif& exif)
+{
+    exif = Exif(filePath);
+    return (findFields(exif) & fields) == fields;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+CacheProvider::CacheProvider(const QString& cacheFilePath) : _cacheFilePath(cacheFilePath) {
+    read();
+}
+
+CacheProvider::~CacheProvider()
+{
+    if (_dirty)
+        write();
+}
+
+bool CacheProvider::load(const QString& filePath, Fields fields, Exif& exif)
+{
+    // Stat outside of the lock
+    const QFileInfo fileInfo(filePath);
+    const QString key       = fileInfo.absoluteFilePath();
+    const qint64  size      = fileInfo.size();
+    const qint64  modified  = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    // Lookups run concurrently, only lastRun changes and it's atomic
+    QReadLocker lock(&_lock);
+    const auto it = _entries.constFind(key);
+    if (it == _entries.constEnd()                       ||
+        it->size     != size                            ||
+        it->modified != modified                        ||
+        (Fields(QFlag(it->fields)) & fields) != fields)
+        return false;
+
+    for (auto property = it->data.begin(); property != it->data.end(); ++property)
+        exif.setValue(property.key(), property.value());
+    if (it->lastRun.fetchAndStoreRelaxed(_run) != _run)
+        _dirty = true;
+    return true;
+}
+
+void CacheProvider::store(const QString& filePath, Fields fields, const Exif& exif)
+{
+    Q_UNUSED(fields)
+
+    // Record what was actually found, which may be more than requested
+    const QFileInfo fileInfo(filePath);
+    Entry entry{fileInfo.size(), fileInfo.lastModified().toMSecsSinceEpoch(),
+                static_cast<int>(findFields(exif)), exif.getData(), 0};
+
+    QWriteLocker lock(&_lock);
+    entry.lastRun.storeRelaxed(_run);
+    _entries.insert(fileInfo.absoluteFilePath(), entry);
+    _dirty = true;
+}
+
+void CacheProvider::move(const QString& from, const QString& to)
+{
+    // The modified date is kept by the move, so the entry stays valid under the new path
+    QWriteLocker lock(&_lock);
+    const auto it = _entries.find(QFileInfo(from).absoluteFilePath());
+    if (it == _entries.end())
+        return;
+
+    Entry entry = it.value();
+    entry.lastRun.storeRelaxed(_run);
+    _entries.erase(it);
+    _entries.insert(QFileInfo(to).absoluteFilePath(), entry);
+    _dirty = true;
+}
+
+void CacheProvider::read()
+{
+    QFile file(_cacheFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 version = 0;
+    quint32 run = 0;
+    int count = 0;
+    stream >> version >> run >> count;
+    if (version != CacheVersion)
+        return;
+
+    // This is a new run, entries not used in it will age
+    _run = run + 1;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        QString filePath;
+        Entry entry;
+        quint32 lastRun = 0;
+        stream >> filePath >> entry.size >> entry.modified >> entry.fields >> entry.data >> lastRun;
+        entry.lastRun.storeRelaxed(lastRun);
+        _entries.insert(filePath, entry);
+    }
+}
+
+void CacheProvider::write() const
+{
+    QFile file(_cacheFilePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    // Drop the entries not used recently, without touching the files
+    std::vector<QHash<QString, Entry>::const_iterator> entries;
+    for (auto it = _entries.constBegin(); it != _entries.constEnd(); ++it)
+        if (_run - it->lastRun.loadRelaxed() < MaxCacheUnusedRuns)
+            entries.push_back(it);
+
+    // Then the least recently used beyond the maximum size
+    if (entries.size() > MaxCacheEntries)
+    {
+        std::nth_element(entries.begin(), entries.begin() + MaxCacheEntries, entries.end(),
+                         [](const auto& lhs, const auto& rhs) {
+            return lhs->lastRun.loadRelaxed() > rhs->lastRun.loadRelaxed();
+        });
+        entries.resize(MaxCacheEntries);
+    }
+
+    QDataStream stream(&file);
+    stream << CacheVersion << _run << static_cast<int>(entries.size());
+    for (const auto& it: entries)
+        stream << it.key() << it->size << it->modified << it->fields << it->data << it->lastRun.loadRelaxed();
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+bool FileNameProvider::load(const QString& filePath, Fields fields, Exif& exif)
+{
+    // e.g., IMG_20200514_101500, PXL_20200514_101500123, 2020-05-14 10.15.00
+    const QRegularExpression regex(R"((?<!\d)(\d{4})[-_.]?(\d{2})[-_.]?(\d{2})[-_ T]?(\d{2})[-_.:]?(\d{2})[-_.:]?(\d{2}))");
+    const QRegularExpressionMatch match = regex.match(QFileInfo(filePath).completeBaseName());
+    if (!match.hasMatch())
+        return false;
+
+    const QDateTime dateTime(QDate(match.captured(1).toInt(), match.captured(2).toInt(), match.captured(3).toInt()),
+                             QTime(match.captured(4).toInt(), match.captured(5).toInt(), match.captured(6).toInt()));
+    if (!dateTime.isValid() || dateTime.date().year() < 1970)
+        return false;
+
+    // Only the creation date can be guessed
+    exif.setValue(GuessedDateProperty, dateTime.toString("yyyy:MM:dd hh:mm:ss"));
+    return !(fields & ~Fields(CreationDate));
+}
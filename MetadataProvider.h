@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Exif.h"
+
+#include <QAtomicInteger>
+#include <QFlags>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+#include <atomic>
+
+///
+/// @brief A source of metadata for some file formats
+///
+/// Implementations must be thread-safe, they are called from the loader threads.
+///
+class MetadataProvider
+{
+public:
+    enum Field
+    {
+        CreationDate = 0x1,
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+
+    virtual ~MetadataProvider() = default;
+
+    virtual QString getName() const = 0;
+
+    /**
+     * @brief Whether the provider handles files of a format
+     * @param suffix    - lower case file extension
+     */
+    virtual bool canHandle(const QString& suffix) const = 0;
+
+    // Fields the provider may answer
+    virtual Fields getFields() const = 0;
+
+    // Rough cost of a load, in microseconds
+    virtual int getCost() const = 0;
+
+    // A guess is only tried when no other provider answered, and is never cached
+    virtual bool isGuess() const { return false; }
+
+    /**
+     * @brief Load the metadata of a file
+     * @param filePath  - the file
+     * @param fields    - requested fields
+     * @param exif      - receives the metadata
+     * @return          - whether all the requested fields were found
+     */
+    virtual bool load(const QString& filePath, Fields fields, Exif& exif) = 0;
+
+    /**
+     * @brief Called with the metadata another provider found, for caching
+     */
+    virtual void store(const QString& filePath, Fields fields, const Exif& exif)
+    {
+        Q_UNUSED(filePath)
+        Q_UNUSED(fields)
+        Q_UNUSED(exif)
+    }
+
+    /**
+     * @brief Called after a file has been moved or renamed, its content unchanged
+     */
+    virtual void move(const QString& from, const QString& to)
+    {
+        Q_UNUSED(from)
+        Q_UNUSED(to)
+    }
+
+    // Fields that can be read from the metadata
+    static Fields findFields(const Exif& exif);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(MetadataProvider::Fields)
+
+///
+/// @brief Native parser of the EXIF in JPEG and TIFF-based raw files
+///
+class ExifParserProvider : public MetadataProvider
+{
+public:
+    QString getName()   const override { return "Built-in"; }
+    bool canHandle(const QString& suffix) const override;
+    Fields getFields()  const override { return CreationDate; }
+    int getCost()       const override { return 100; }
+    bool load(const QString& filePath, Fields fields, Exif& exif) override;
+};
+
+///
+/// @brief Runs exiftool, handles every format
+///
+class ExiftoolProvider : public MetadataProvider
+{
+public:
+    QString getName()   const override { return "Exiftool"; }
+    bool canHandle(const QString&) const override { return true; }
+    Fields getFields()  const override { return CreationDate; }
+    int getCost()       const override { return 100000; }
+    bool load(const QString& filePath, Fields fields, Exif& exif) override;
+};
+
+///
+/// @brief Metadata found earlier, valid while the size and modified date of the file are unchanged
+///
+/// Entries follow the files moved by the app. Those not used for a number of runs are dropped,
+/// and so are the least recently used ones beyond a maximum size.
+///
+class CacheProvider : public MetadataProvider
+{
+public:
+    CacheProvider(const QString& cacheFilePath);
+    ~CacheProvider() override;
+
+    QString getName()   const override { return "Cache"; }
+    bool canHandle(const QString&) const override { return true; }
+    Fields getFields()  const override { return CreationDate; }
+    int getCost()       const override { return 10; }
+    bool load(const QString& filePath, Fields fields, Exif& exif) override;
+    void store(const QString& filePath, Fields fields, const Exif& exif) override;
+    void move(const QString& from, const QString& to) override;
+
+private:
+    struct Entry
+    {
+        qint64      size;
+        qint64      modified;   // msecs since epoch
+        int         fields;
+        Exif::Data  data;
+
+        // Run in which it was last used, updated by lookups under the read lock
+        mutable QAtomicInteger<quint32> lastRun;
+    };
+
+    void read();
+    void write() const;
+
+private:
+    QString                 _cacheFilePath;
+    QHash<QString, Entry>   _entries;
+    quint32                 _run{0};    // runs since the cache was created
+    mutable QReadWriteLock  _lock;
+    std::atomic_bool        _dirty{false};
+};
+
+///
+/// @brief Infers the date from file names such as IMG_20200514_101500.jpg
+///
+/// The date is stored under its own property, so that it's never mistaken for the EXIF creation date.
+///
+class FileNameProvider : public MetadataProvider
+{
+public:
+    static constexpr auto GuessedDateProperty = "Guessed Date";
+
+    QString getName()   const override { return "File name"; }
+    bool canHandle(const QString&) const override { return true; }
+    Fields getFields()  const override { return CreationDate; }
+    int getCost()       const override { return 1; }
+    bool isGuess()      const override { return true; }
+    bool load(const QString& filePath, Fields fields, Exif& exif) override;
+};
@@ -0,0 +1,66 @@
+#include "MetadataQueue.h"
+
+#include <algorithm>
+
+int MetadataQueue::enqueue(const QStringList& filePaths, int maxWorkers)
+{
+    QMutexLocker lock(&_mutex);
+    for (const auto& filePath: filePaths)
+    {
+        if (!_pending.contains(filePath))
+        {
+            _pending << filePath;
+            _background.push_back(filePath);
+        }
+    }
+
+    const int newWorkers = std::max(0, std::min(maxWorkers, _pending.count()) - _numWorkers);
+    _numWorkers += newWorkers;
+    return newWorkers;
+}
+
+void MetadataQueue::prioritize(const QStringList& filePaths)
+{
+    QMutexLocker lock(&_mutex);
+    _urgent.clear();
+    for (const auto& filePath: filePaths)
+        if (_pending.contains(filePath))
+            _urgent << filePath;
+}
+
+bool MetadataQueue::take(QString& filePath)
+{
+    QMutexLocker lock(&_mutex);
+
+    // Entries already taken from the other queue, or removed, are skipped
+    while (!_urgent.isEmpty())
+    {
+        filePath = _urgent.takeFirst();
+        if (_pending.remove(filePath))
+            return true;
+    }
+    while (!_background.empty())
+    {
+        filePath = _background.front();
+        _background.pop_front();
+        if (_pending.remove(filePath))
+            return true;
+    }
+
+    --_numWorkers;
+    return false;
+}
+
+void MetadataQueue::remove(const QString& filePath)
+{
+    QMutexLocker lock(&_mutex);
+    _pending.remove(filePath);
+}
+
+void MetadataQueue::clear()
+{
+    QMutexLocker lock(&_mutex);
+    _urgent.clear();
+    _background.clear();
+    _pending.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <deque>
+
+///
+/// @brief Files waiting for their metadata, shared by the loader threads
+///
+/// Urgent files (e.g., visible rows) are taken before the others, which are
+/// taken in the order they were added.
+///
+class MetadataQueue
+{
+public:
+    /**
+     * @brief Add files to the background queue
+     * @param filePaths     - the files
+     * @param maxWorkers    - max # of loader threads
+     * @return              - # of loader threads to start
+     */
+    int enqueue(const QStringList& filePaths, int maxWorkers);
+
+    /**
+     * @brief Replace the urgent files, only those still pending are kept
+     */
+    void prioritize(const QStringList& filePaths);
+
+    /**
+     * @brief Take the next file, called by the loader threads
+     * @param filePath  - receives the file
+     * @return          - false if there is nothing left, then the thread must finish
+     */
+    bool take(QString& filePath);
+
+    void remove(const QString& filePath);
+    void clear();
+
+private:
+    QMutex              _mutex;
+    QStringList         _urgent;
+    std::deque<QString> _background;
+    QSet<QString>       _pending;       // files in either queue, not taken yet
+    int                 _numWorkers{0};
+};
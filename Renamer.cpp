@@ -1,4 +1,5 @@
 #include "Exif.h"
+#include "Gazetteer.h"
 #include "Renamer.h"
 #include <QSettings>
 #include <QFileInfo>
@@ -7,37 +8,106 @@
 #include <QRegularExpression>
 #include <cmath>
 
+namespace {
+// Place names may contain reserved characters, e.g., "Biel/Bienne"
+QString toFileName(const QString& name)
+{
+    QString result = name;
+    result.replace(QRegularExpression(R"([/\\:*?"<>|\x00-\x1f])"), "-");
+    return result.trimmed();
+}
+
+// Remove the whitespace and separators left at either end by an empty place, e.g., "Trip to "
+QString trimSection(const QString& section, const QString& separator)
+{
+    QString result = section.trimmed();
+    while (!separator.isEmpty() && result.startsWith(separator))
+        result = result.mid(separator.length()).trimmed();
+    while (!separator.isEmpty() && result.endsWith(separator))
+        result = result.left(result.length() - separator.length()).trimmed();
+    return result;
+}
+}
+
 QStringList Renamer::run(QSettings* settings, const QFileInfoList& fileInfos, const QList<QDateTime>& dateTimes)
 {
+    return run(settings, fileInfos, dateTimes, {}, fileInfos.length(), [](int, const QStringList&) { return true; });
+}
+
+QStringList Renamer::run(QSettings* settings, const QFileInfoList& fileInfos, const QList<QDateTime>& dateTimes,
+                         const QList<QPointF>& positions, int batchSize, const BatchCallback& onBatch)
+{
+    // Load the template
+    Template nameTemplate;
+    nameTemplate.separator      = settings->value("Separator")      .toString();
+    nameTemplate.datePattern    = settings->value("DatePattern")    .toString();
+    nameTemplate.people         = settings->value("People")         .toString();
+    nameTemplate.event          = settings->value("Event")          .toString();
+    nameTemplate.indexPattern   = settings->value("IndexPattern")   .toString();
+    nameTemplate.targetPath     = settings->value("TargetPath")     .toString();
+
+    // Open the gazetteer only when needed, building its index the first time
+    const QString gazetteerPath = settings->value("GazetteerPath").toString();
+    if (!gazetteerPath.isEmpty() &&
+        (nameTemplate.people.contains("$place$") || nameTemplate.event.contains("$place$")))
+    {
+        nameTemplate.gazetteer = std::make_shared<Gazetteer>(gazetteerPath);
+        if (!nameTemplate.gazetteer->isValid())
+            nameTemplate.gazetteer.reset();
+    }
+
     QMap<QDate, int> date2Count;   // date -> total # of files on that date
     foreach (const QDateTime& dateTime, dateTimes)
         date2Count[dateTime.date()] ++;
 
     QStringList result;
+    QSet<QString> newFilePaths;     // for fast duplication check
     QMap<QDate, int> date2Index;   // date -> index (starting from 1) of the file in the list of that date
+    int batchStart = 0;
     for (int i = 0; i < fileInfos.length(); ++i)
     {
         QFileInfo fileInfo = fileInfos.at(i);
         QDate date = dateTimes.at(i).date();
         date2Index[date] ++;
 
-        QString newName = run(settings, fileInfo, dateTimes.at(i), result, date2Count[date],
+        const QPointF position = i < positions.length() ? positions.at(i) : QPointF(qQNaN(), qQNaN());
+        QString newName = run(nameTemplate, fileInfo, dateTimes.at(i), position, newFilePaths, date2Count[date],
                               date2Index[date], static_cast<int>(log10(date2Count[date])) + 1);
         result << newName;
+        newFilePaths << newName;
+
+        // Report a full batch, or the last one
+        if (result.length() - batchStart == batchSize || i == fileInfos.length() - 1)
+        {
+            if (!onBatch(batchStart, result.mid(batchStart)))
+                break;
+            batchStart = result.length();
+        }
     }
     return result;
 }
 
-QString Renamer::run(QSettings* settings, const QFileInfo& fileInfo, const QDateTime& dateTime,
-                     const QStringList& newFilePaths, int groupSize, int index, int length)
+QString Renamer::run(const Template& nameTemplate, const QFileInfo& fileInfo, const QDateTime& dateTime,
+                     const QPointF& position, const QSet<QString>& newFilePaths, int groupSize, int index, int length)
 {
-    // Load the template
-    QString separator       = settings->value("Separator")      .toString();
-    QString datePattern     = settings->value("DatePattern")    .toString();
-    QString people          = settings->value("People")         .toString();
-    QString event           = settings->value("Event")          .toString();
-    QString indexPattern    = settings->value("IndexPattern")   .toString();
+    const QString& separator    = nameTemplate.separator;
+    const QString& datePattern  = nameTemplate.datePattern;
+    QString people              = nameTemplate.people;
+    QString event               = nameTemplate.event;
+    const QString& indexPattern = nameTemplate.indexPattern;
+    const QString& targetPath   = nameTemplate.targetPath;
 
+    // place, empty when the position is unknown or there is no gazetteer
+    if (people.contains("$place$") || event.contains("$place$"))
+    {
+        const QString place = nameTemplate.gazetteer && !qIsNaN(position.x())
+                ? toFileName(nameTemplate.gazetteer->findPlace(position.x(), position.y()))
+                : QString();
+        if (people.contains("$place$"))
+            people = trimSection(people.replace("$place$", place), separator);
+        if (event.contains("$place$"))
+            event  = trimSection(event .replace("$place$", place), separator);
+    }
 
     QStringList sections;
     if (!datePattern.isEmpty())
@@ -56,15 +126,15 @@ QString Renamer::run(QSettings* settings, const QFileInfo& fileInfo, const QDate
         sections << indexNumber;
     }
 
-    // path and file extension are not changed
-    QString destPath = fileInfo.path();
+    // file extension is not changed, path is changed only when moving into a target folder
+    QString destPath = targetPath.isEmpty() ? fileInfo.path() : QDir::cleanPath(targetPath);
     QString extension = fileInfo.suffix().isEmpty() ? QString()
                                                     : "." + fileInfo.suffix();
     QString filePath = destPath + QDir::separator() + sections.join(separator) + extension; // [path]/[file name][.extension]
     return getValidFilePath(filePath, newFilePaths);    // check duplication
 }
 
-QString Renamer::getValidFilePath(const QString& filePath, const QStringList& newFilePaths)
+QString Renamer::getValidFilePath(const QString& filePath, const QSet<QString>& newFilePaths)
 {
     // No duplication, return
     if (!QFile::exists(filePath) && !newFilePaths.contains(filePath))
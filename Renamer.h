@@ -1,14 +1,27 @@
 #pragma once
 
 #include <QFileInfoList>
+#include <QPointF>
+#include <QSet>
 #include <QString>
+#include <functional>
+#include <memory>
 
 class QSettings;
 class QFileInfo;
+class Gazetteer;
 
 class Renamer
 {
 public:
+    /**
+     * Receives a batch of new names
+     * @param first         - index of the first file of the batch
+     * @param newFilePaths  - new names of the files in the batch
+     * @return              - false to cancel the renaming
+     */
+    using BatchCallback = std::function<bool(int first, const QStringList& newFilePaths)>;
+
     /**
      * @brief Rename a list of files based on a given template
      * @param settings  - the renaming template
@@ -17,19 +30,48 @@ public:
      */
     QStringList run(QSettings* settings, const QFileInfoList& filePaths, const QList<QDateTime>& dateTimes);
 
+    /**
+     * @brief Rename a list of files based on a given template, reporting the new names in batches
+     * @param settings  - the renaming template
+     * @param fileInfos - the list of files
+     * @param positions - GPS positions (x: latitude, y: longitude) of the files for $place$, NaN if unknown
+     * @param batchSize - # of files in a batch
+     * @param onBatch   - called after each batch
+     * @return          - a list of new names, incomplete if cancelled by onBatch
+     */
+    QStringList run(QSettings* settings, const QFileInfoList& filePaths, const QList<QDateTime>& dateTimes,
+                    const QList<QPointF>& positions, int batchSize, const BatchCallback& onBatch);
+
 private:
+    /**
+     * The renaming template, loaded from the settings once per run
+     */
+    struct Template
+    {
+        QString separator;
+        QString datePattern;
+        QString people;
+        QString event;
+        QString indexPattern;
+        QString targetPath;
+
+        // Resolves $place$, null if not used
+        std::shared_ptr<Gazetteer> gazetteer;
+    };
+
     /**
      * @brief Get the new name of a file based on a template
-     * @param settings  - renaming template
-     * @param fileInfo  - the file to be renamed
-     * @param newPaths  - paths of files already renamed yet to be written to disk
-     * @param groupSize - # of files in the same-dated file group
-     * @param index     - index of this file in the group
-     * @param length    - length of the index (ie, how many digits)
-     * @return          - a valid new name
+     * @param nameTemplate  - renaming template
+     * @param fileInfo      - the file to be renamed
+     * @param position      - GPS position of the file, NaN if unknown
+     * @param newPaths      - paths of files already renamed yet to be written to disk
+     * @param groupSize     - # of files in the same-dated file group
+     * @param index         - index of this file in the group
+     * @param length        - length of the index (ie, how many digits)
+     * @return              - a valid new name
      */
-    QString run(QSettings* settings, const QFileInfo& fileInfo, const QDateTime& dateTime,
-                const QStringList& newFilePaths, int groupSize, int index = 0, int length = 3);
+    QString run(const Template& nameTemplate, const QFileInfo& fileInfo, const QDateTime& dateTime,
+                const QPointF& position, const QSet<QString>& newFilePaths, int groupSize, int index = 0, int length = 3);
 
     /**
      * @brief Attemps to find a valid name that a given file can be renamed to.
@@ -37,5 +79,5 @@ private:
      * @param newPaths  - paths of files already renamed yet to be written to disk
      * @return          - A valid new file path
      */
-    QString getValidFilePath(const QString& filePath, const QStringList& newPaths);
+    QString getValidFilePath(const QString& filePath, const QSet<QString>& newPaths);
 };
@@ -22,12 +22,26 @@ SOURCES +=\
     Main.cpp \
     Renamer.cpp \
     DlgSettings.cpp \
-    Exif.cpp
+    Exif.cpp \
+    FileMover.cpp \
+    FileIndex.cpp \
+    FileFilterModel.cpp \
+    MetadataProvider.cpp \
+    MetadataLoader.cpp \
+    MetadataQueue.cpp \
+    Gazetteer.cpp
 
 HEADERS  += MainWindow.h \
     Renamer.h \
     DlgSettings.h \
-    Exif.h
+    Exif.h \
+    FileMover.h \
+    FileIndex.h \
+    FileFilterModel.h \
+    MetadataProvider.h \
+    MetadataLoader.h \
+    MetadataQueue.h \
+    Gazetteer.h
 
 FORMS    += MainWindow.ui \
     DlgSettings.ui